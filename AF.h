@@ -3,6 +3,7 @@
 
 
 #include "AF/actor.h"
+#include "AF/actor_group.h"
 #include "AF/address.h"
 #include "AF/align.h"
 #include "AF/allocator_interface.h"
@@ -12,8 +13,15 @@
 #include "AF/catcher.h"
 #include "AF/default_allocator.h"
 #include "AF/defines.h"
+#include "AF/flow_control.h"
 #include "AF/framework.h"
+#include "AF/message_priority.h"
+#include "AF/overflow_policy.h"
+#include "AF/queue_strategy.h"
 #include "AF/receiver.h"
 #include "AF/register.h"
+#include "AF/send_result.h"
+#include "AF/shared_payload.h"
+#include "AF/yield_strategy.h"
 
 #endif // AF_AF_H
@@ -2,13 +2,18 @@
 #define AF_ACTOR_H
 
 
+#include "AF/actor_group.h"
 #include "AF/address.h"
 #include "AF/align.h"
 #include "AF/allocator_interface.h"
 #include "AF/allocator_manager.h"
 #include "AF/basic_types.h"
 #include "AF/defines.h"
+#include "AF/flow_control.h"
 #include "AF/framework.h"
+#include "AF/message_priority.h"
+#include "AF/overflow_policy.h"
+#include "AF/send_result.h"
 
 #include "AF/detail/directory/directory.h"
 
@@ -26,6 +31,9 @@
 #include "AF/detail/threading/atomic.h"
 #include "AF/detail/utils/utils.h"
 
+#include <type_traits>
+#include <utility>
+
 
 namespace AF
 {
@@ -56,6 +64,28 @@ public:
 
     inline uint32_t GetNumQueuedMessages() const;
 
+    /*
+     * Limits the number of messages queued for the actor, or removes the limit if the capacity
+     * is zero. The policy says what becomes of messages sent to the actor while it's at capacity.
+     */
+    inline void SetMailboxCapacity(const uint32_t capacity, const OverflowPolicy policy = OVERFLOW_POLICY_REJECT);
+
+    inline uint32_t GetMailboxCapacity() const;
+
+    /*
+     * Opts the actor into flow control, granting its senders the given window of credits, or opts
+     * it out if the window is zero. Each message queued for the actor takes a credit, which is
+     * returned once the message is processed. The mode says what becomes of sends without credit.
+     */
+    inline void SetCreditWindow(const uint32_t window, const FlowControlMode mode = FLOW_CONTROL_DEFER);
+
+    inline uint32_t GetCreditWindow() const;
+
+    /*
+     * Gets the number of sends to the actor that found no credit, since its window was last set.
+     */
+    inline uint32_t GetNumThrottledSends() const;
+
 protected:
 
     template <class ActorType, class ValueType>
@@ -73,6 +103,26 @@ protected:
         ActorType *const actor,
         void (ActorType::*handler)(const ValueType &message, const Address from));
 
+    /*
+     * Registers a handler that takes ownership of the message value, so it can move the value on
+     * without copying it. If other handlers are registered for the same message type, only the
+     * last handler run takes the value itself, and the handler otherwise receives a copy.
+     */
+    template <class ActorType, class ValueType>
+    inline bool RegisterHandler(
+        ActorType *const actor,
+        void (ActorType::*handler)(ValueType &&message, const Address from));
+
+    template <class ActorType, class ValueType>
+    inline bool DeregisterHandler(
+        ActorType *const actor,
+        void (ActorType::*handler)(ValueType &&message, const Address from));
+
+    template <class ActorType, class ValueType>
+    inline bool IsHandlerRegistered(
+        ActorType *const actor,
+        void (ActorType::*handler)(ValueType &&message, const Address from));
+
     template <class ActorType>
     inline bool SetDefaultHandler(
         ActorType *const actor,
@@ -86,12 +136,53 @@ protected:
     template <class ValueType>
     inline bool Send(const ValueType &value, const Address &address) const;
 
+    /*
+     * Sends a copy of a value with the given priority, overriding the default priority of its type.
+     */
+    template <class ValueType>
+    inline bool Send(const ValueType &value, const Address &address, const MessagePriority priority) const;
+
+    /*
+     * Sends a temporary value, moving it into the message instead of copying it.
+     */
+    template <class ValueType, class = typename std::enable_if<!std::is_lvalue_reference<ValueType>::value>::type>
+    inline bool Send(ValueType &&value, const Address &address) const;
+
+    /*
+     * Sends a message whose value is constructed in place from the given arguments.
+     */
+    template <class ValueType, class... ArgTypes>
+    inline bool Emplace(const Address &address, ArgTypes &&... args) const;
+
+    /*
+     * Sends a copy of a value, returning what became of the message.
+     */
+    template <class ValueType>
+    inline SendResult TrySend(const ValueType &value, const Address &address) const;
+
+    /*
+     * Sends a copy of a value to each of an array of addresses.
+     * The value is copied once into a single memory block shared by all the messages, and the
+     * receiving mailboxes are scheduled together. Returns true if every message was delivered.
+     */
+    template <class ValueType>
+    inline bool SendMulti(const ValueType &value, const Address *const addresses, const uint32_t count) const;
+
+    /*
+     * Sends a copy of a value to each member of an actor group.
+     */
+    template <class ValueType>
+    inline bool SendMulti(const ValueType &value, const ActorGroup &group) const;
+
 private:
 
     // Actors are non-copyable.
     Actor(const Actor &other);
     Actor &operator=(const Actor &other);
 
+    template <class ValueType, class... ArgTypes>
+    inline SendResult EmplaceInternal(const Address &address, const MessagePriority priority, ArgTypes &&... args) const;
+
     inline void ProcessMessage(
         Detail::MailboxContext *const mailbox_context,
         Detail::FallbackHandlerCollection *const fallback_handlers,
@@ -127,6 +218,36 @@ AF_FORCEINLINE uint32_t Actor::GetNumQueuedMessages() const {
     return mailbox.Count();
 }
 
+AF_FORCEINLINE void Actor::SetMailboxCapacity(const uint32_t capacity, const OverflowPolicy policy) {
+    Detail::Mailbox &mailbox(framework_->mailboxes_.GetEntry(address_.AsInteger()));
+    mailbox.SetCapacity(capacity, policy);
+}
+
+AF_FORCEINLINE uint32_t Actor::GetMailboxCapacity() const {
+    const Detail::Mailbox &mailbox(framework_->mailboxes_.GetEntry(address_.AsInteger()));
+    return mailbox.GetCapacity();
+}
+
+AF_FORCEINLINE void Actor::SetCreditWindow(const uint32_t window, const FlowControlMode mode) {
+    Detail::Mailbox &mailbox(framework_->mailboxes_.GetEntry(address_.AsInteger()));
+    mailbox.SetCreditWindow(window, mode);
+
+    // A wider window may have credit for blocked senders.
+    if (mailbox.HasCreditWaiters()) {
+        framework_->scheduler_->SignalCredit();
+    }
+}
+
+AF_FORCEINLINE uint32_t Actor::GetCreditWindow() const {
+    const Detail::Mailbox &mailbox(framework_->mailboxes_.GetEntry(address_.AsInteger()));
+    return mailbox.GetCreditWindow();
+}
+
+AF_FORCEINLINE uint32_t Actor::GetNumThrottledSends() const {
+    const Detail::Mailbox &mailbox(framework_->mailboxes_.GetEntry(address_.AsInteger()));
+    return mailbox.GetThrottledCount();
+}
+
 template <class ActorType, class ValueType>
 inline bool Actor::RegisterHandler(
     ActorType *const actor,
@@ -149,6 +270,27 @@ inline bool Actor::IsHandlerRegistered(
     return message_handlers_.Contains(handler);
 }
 
+template <class ActorType, class ValueType>
+inline bool Actor::RegisterHandler(
+    ActorType *const actor,
+    void (ActorType::*handler)(ValueType &&message, const Address from)) {
+    return message_handlers_.Add(handler);
+}
+
+template <class ActorType, class ValueType>
+inline bool Actor::DeregisterHandler(
+    ActorType *const actor,
+    void (ActorType::*handler)(ValueType &&message, const Address from)) {
+    return message_handlers_.Remove(handler);
+}
+
+template <class ActorType, class ValueType>
+inline bool Actor::IsHandlerRegistered(
+    ActorType *const actor,
+    void (ActorType::*handler)(ValueType &&message, const Address from)) {
+    return message_handlers_.Contains(handler);
+}
+
 template <class ActorType>
 inline bool Actor::SetDefaultHandler(
     ActorType *const actor,
@@ -165,6 +307,36 @@ inline bool Actor::SetDefaultHandler(
 
 template <class ValueType>
 AF_FORCEINLINE bool Actor::Send(const ValueType &value, const Address &address) const {
+    return Emplace<ValueType>(address, value);
+}
+
+template <class ValueType>
+AF_FORCEINLINE bool Actor::Send(const ValueType &value, const Address &address, const MessagePriority priority) const {
+    return Framework::Accepted(EmplaceInternal<ValueType>(address, priority, value));
+}
+
+template <class ValueType, class>
+AF_FORCEINLINE bool Actor::Send(ValueType &&value, const Address &address) const {
+    // Const temporaries are sent as messages of the unqualified type, so they reach its handlers.
+    typedef typename std::remove_const<ValueType>::type MessageType;
+    return Emplace<MessageType>(address, std::move(value));
+}
+
+template <class ValueType, class... ArgTypes>
+AF_FORCEINLINE bool Actor::Emplace(const Address &address, ArgTypes &&... args) const {
+    return Framework::Accepted(EmplaceInternal<ValueType>(
+        address,
+        Detail::MessagePriorityTraits<ValueType>::PRIORITY,
+        std::forward<ArgTypes>(args)...));
+}
+
+template <class ValueType>
+AF_FORCEINLINE SendResult Actor::TrySend(const ValueType &value, const Address &address) const {
+    return EmplaceInternal<ValueType>(address, Detail::MessagePriorityTraits<ValueType>::PRIORITY, value);
+}
+
+template <class ValueType, class... ArgTypes>
+AF_FORCEINLINE SendResult Actor::EmplaceInternal(const Address &address, const MessagePriority priority, ArgTypes &&... args) const {
     // Try to use the processor context owned by a worker thread.
     // The current thread will be a worker thread if this method has been called from a message
     // handler. If it was called from an actor constructor or destructor then the current thread
@@ -179,12 +351,14 @@ AF_FORCEINLINE bool Actor::Send(const ValueType &value, const Address &address)
     }
 
     // Allocate a message. It'll be deleted by the worker thread that handles it.
-    Detail::MessageInterface *const message(Detail::MessageCreator::Create(
+    Detail::MessageInterface *const message(Detail::MessageCreator::Create<ValueType>(
         mailbox_context->message_allocator_,
-        value,
-        address_));
+        address_,
+        std::forward<ArgTypes>(args)...));
 
     if (message) {
+        message->SetPriority(priority);
+
         // Call the message sending implementation using the acquired processor context.
         return framework_->SendInternal(
             mailbox_context,
@@ -192,9 +366,44 @@ AF_FORCEINLINE bool Actor::Send(const ValueType &value, const Address &address)
             address);
     }
 
+    return SEND_RESULT_NO_MEMORY;
+}
+
+template <class ValueType>
+inline bool Actor::SendMulti(const ValueType &value, const Address *const addresses, const uint32_t count) const {
+    if (count == 0) {
+        return true;
+    }
+
+    // Use the worker thread's context if we're in a handler, as in Emplace.
+    Detail::MailboxContext *mailbox_context(mailbox_context_);
+    if (mailbox_context_ == 0) {
+        mailbox_context = framework_->GetMailboxContext();
+    }
+
+    // Allocate all the messages, and one copy of the value, in a single block.
+    Detail::Message<ValueType> *const messages(Detail::MessageCreator::CreateShared<ValueType>(
+        mailbox_context->message_allocator_,
+        count,
+        address_,
+        value));
+
+    if (messages) {
+        return framework_->SendMultiInternal(
+            mailbox_context,
+            messages,
+            addresses,
+            count);
+    }
+
     return false;
 }
 
+template <class ValueType>
+AF_FORCEINLINE bool Actor::SendMulti(const ValueType &value, const ActorGroup &group) const {
+    return SendMulti(value, group.GetAddresses(), group.Size());
+}
+
 AF_FORCEINLINE void Actor::ProcessMessage(
     Detail::MailboxContext *const mailbox_context,
     Detail::FallbackHandlerCollection *const fallback_handlers,
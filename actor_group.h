@@ -0,0 +1,165 @@
+#ifndef AF_ACTORGROUP_H
+#define AF_ACTORGROUP_H
+
+
+#include <new>
+
+#include "AF/address.h"
+#include "AF/allocator_interface.h"
+#include "AF/allocator_manager.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+
+namespace AF
+{
+
+/*
+ * A set of actor addresses, used to send the same message to every member at once.
+ *
+ * Groups are passed to Actor::SendMulti or Framework::SendMulti, which allocate the message
+ * value once for the whole group and schedule the receiving mailboxes together. The member
+ * addresses are held in a contiguous array, in the order in which they were added.
+ *
+ * Groups aren't thread-safe, and shouldn't be modified while a send to the group is in progress.
+ */
+class ActorGroup {
+public:
+    inline ActorGroup();
+
+    inline ~ActorGroup();
+
+    /*
+     * Adds an address to the group. Returns false if the address is already a member,
+     * or if memory for the member couldn't be allocated.
+     */
+    inline bool Add(const Address &address);
+
+    /*
+     * Removes an address from the group. Returns false if the address isn't a member.
+     * The last member takes the place of the removed one.
+     */
+    inline bool Remove(const Address &address);
+
+    inline bool Contains(const Address &address) const;
+
+    inline void Clear();
+
+    inline uint32_t Size() const;
+
+    /*
+     * Gets the array of member addresses, which is valid until the group is next modified.
+     */
+    inline const Address *GetAddresses() const;
+
+private:
+    static const uint32_t INITIAL_CAPACITY = 8;
+
+    ActorGroup(const ActorGroup &other);
+    ActorGroup &operator=(const ActorGroup &other);
+
+    inline bool Reserve(const uint32_t capacity);
+
+    Address *addresses_;        // Array of member addresses, allocated from the cache.
+    uint32_t size_;             // Number of members.
+    uint32_t capacity_;         // Number of addresses the array can hold.
+};
+
+
+AF_FORCEINLINE ActorGroup::ActorGroup()
+  : addresses_(0),
+    size_(0),
+    capacity_(0) {
+}
+
+inline ActorGroup::~ActorGroup() {
+    Clear();
+
+    if (addresses_) {
+        AllocatorManager::GetCache()->FreeWithSize(addresses_, capacity_ * sizeof(Address));
+    }
+}
+
+inline bool ActorGroup::Add(const Address &address) {
+    if (Contains(address)) {
+        return false;
+    }
+
+    if (size_ == capacity_ && !Reserve(capacity_ ? capacity_ * 2 : INITIAL_CAPACITY)) {
+        return false;
+    }
+
+    new (addresses_ + size_) Address(address);
+    ++size_;
+
+    return true;
+}
+
+inline bool ActorGroup::Remove(const Address &address) {
+    for (uint32_t index = 0; index < size_; ++index) {
+        if (addresses_[index] == address) {
+            --size_;
+            addresses_[index] = addresses_[size_];
+            addresses_[size_].~Address();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline bool ActorGroup::Contains(const Address &address) const {
+    for (uint32_t index = 0; index < size_; ++index) {
+        if (addresses_[index] == address) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void ActorGroup::Clear() {
+    while (size_) {
+        addresses_[--size_].~Address();
+    }
+}
+
+AF_FORCEINLINE uint32_t ActorGroup::Size() const {
+    return size_;
+}
+
+AF_FORCEINLINE const Address *ActorGroup::GetAddresses() const {
+    return addresses_;
+}
+
+inline bool ActorGroup::Reserve(const uint32_t capacity) {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    void *const memory(allocator->Allocate(capacity * sizeof(Address)));
+    if (memory == 0) {
+        return false;
+    }
+
+    // Copy the members into the new array and destroy the originals.
+    Address *const addresses(reinterpret_cast<Address *>(memory));
+    for (uint32_t index = 0; index < size_; ++index) {
+        new (addresses + index) Address(addresses_[index]);
+        addresses_[index].~Address();
+    }
+
+    if (addresses_) {
+        allocator->FreeWithSize(addresses_, capacity_ * sizeof(Address));
+    }
+
+    addresses_ = addresses;
+    capacity_ = capacity;
+
+    return true;
+}
+
+
+} // namespace AF
+
+
+#endif // AF_ACTORGROUP_H
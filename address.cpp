@@ -1,4 +1,15 @@
 #include "AF/address.h"
+#include "AF/framework.h"
+#include "AF/receiver.h"
+
+#include "AF/detail/directory/name_registry.h"
+#include "AF/detail/directory/static_directory.h"
+
+#include "AF/detail/mailboxes/mailbox.h"
+
+#include "AF/detail/strings/string.h"
+
+#include "AF/detail/utils/utils.h"
 
 
 namespace AF
@@ -6,5 +17,98 @@ namespace AF
 
 Address Address::null_address_;
 
-} // namespace AF
+/*
+ * Generates the default name of an entity from its index and generation,
+ * scoped by the name of its framework if it has one.
+ */
+static Detail::String GenerateName(const uint32_t index, const uint32_t generation, const char *const framework_name) {
+    char raw_name[16];
+    Detail::NameGenerator::Generate(raw_name, index, generation);
+
+    char scoped_name[256];
+    Detail::NameGenerator::Combine(
+        scoped_name,
+        256,
+        raw_name,
+        framework_name);
+
+    return Detail::String(scoped_name);
+}
+
+Address::Address(const char *const name) : index_(Detail::NameRegistry::Resolve(name)) {
+}
+
+const char *Address::AsString() const {
+    const uint32_t framework_index(index_.componets_.framework_);
+    const uint32_t index(index_.componets_.index_);
+    const uint32_t generation(index_.componets_.generation_);
+    const char *name(0);
+
+    if (index == 0) {
+        return 0;
+    }
+
+    if (framework_index == 0) {
+        // Receivers are identified by a framework index of zero, and hold their own names.
+        Detail::Entry *const acquired(Detail::StaticDirectory<Receiver>::Acquire(index));
+        if (acquired == 0) {
+            return 0;
+        }
+
+        Detail::Entry &entry(*acquired);
+
+        entry.Lock();
+
+        Receiver *const receiver(static_cast<Receiver *>(entry.GetEntity()));
+        if (receiver && Detail::StaticDirectory<Receiver>::GetGeneration(index) == generation) {
+            if (receiver->name_.IsNull()) {
+                receiver->name_ = GenerateName(index, generation, 0);
+            }
 
+            name = receiver->name_.GetValue();
+        }
+
+        entry.Unlock();
+
+        Detail::StaticDirectory<Receiver>::Release(index);
+        return name;
+    }
+
+    // Actor names are held by their mailboxes. The framework entry is held locked
+    // so the framework can't be destroyed while its mailbox is read.
+    Detail::Entry *const acquired(Detail::StaticDirectory<Framework>::Acquire(framework_index));
+    if (acquired == 0) {
+        return 0;
+    }
+
+    Detail::Entry &entry(*acquired);
+
+    entry.Lock();
+
+    // The mailbox page is acquired in case it's been reclaimed. The generation is checked
+    // under the mailbox lock, so a reused mailbox can't be registered while we read it.
+    Framework *const framework(static_cast<Framework *>(entry.GetEntity()));
+    if (framework) {
+        if (Detail::Mailbox *const mailbox = framework->mailboxes_.Acquire(index)) {
+            mailbox->Lock();
+
+            if (mailbox->GetActor() && framework->mailboxes_.GetGeneration(index) == generation) {
+                if (mailbox->GetName().IsNull()) {
+                    mailbox->SetName(GenerateName(index, generation, framework->name_.GetValue()));
+                }
+
+                name = mailbox->GetName().GetValue();
+            }
+
+            mailbox->Unlock();
+            framework->mailboxes_.Release(index);
+        }
+    }
+
+    entry.Unlock();
+
+    Detail::StaticDirectory<Framework>::Release(framework_index);
+    return name;
+}
+
+} // namespace AF
@@ -1,11 +1,11 @@
 #ifndef AF_ADDRESS_H
 #define AF_ADDRESS_H
 
+#include <functional>
+
 #include "AF/basic_types.h"
 #include "AF/defines.h"
 
-#include "AF/detail/strings/string.h"
-
 #include "AF/detail/utils/utils.h"
 
 namespace AF
@@ -32,19 +32,22 @@ public:
         return null_address_;
     }
 
-    AF_FORCEINLINE Address() : name_(), index_() {
+    AF_FORCEINLINE Address() : index_() {
     }
 
-    AF_FORCEINLINE explicit Address(const char *const name) : name_(name), index_() {
-    }
+    /*
+     * Constructs the address of the actor registered with the given name, or the null address
+     * if no actor has that name. Names are resolved when the address is constructed, through
+     * a per-thread cache, so an address built from a name doesn't follow the name to a new actor.
+     * Names are registered only while a framework exists, and mustn't be resolved while the
+     * last framework is being destroyed.
+     */
+    explicit Address(const char *const name);
 
-    AF_FORCEINLINE Address(const Address &other) 
-      : name_(other.name_),
-        index_(other.index_) {
+    AF_FORCEINLINE Address(const Address &other) : index_(other.index_) {
     }
 
     AF_FORCEINLINE Address &operator=(const Address &other) {
-        name_ = other.name_;
         index_ = other.index_;
         return *this;
     }
@@ -56,20 +59,24 @@ public:
         return index_.componets_.framework_;
     }
 
-    AF_FORCEINLINE const char *AsString() const {
-        return name_.GetValue();
-    }
+    /*
+     * Gets the string name of the addressed entity, looked up from the entity itself.
+     * Entities that weren't given a name are named from their index when first asked.
+     * The name remains valid while the entity exists. Returns null for the null address
+     * and for addresses of entities that no longer exist.
+     */
+    const char *AsString() const;
 
     AF_FORCEINLINE uint32_t AsInteger() const {
         return index_.componets_.index_;
     }
 
     AF_FORCEINLINE uint64_t AsUInt64() const {
-        return static_cast<uint64_t>(index_.uint32_);
+        return index_.uint64_;
     }
 
     AF_FORCEINLINE bool operator==(const Address &other) const {
-        return (name_ == other.name_);
+        return (index_ == other.index_);
     }
 
     AF_FORCEINLINE bool operator!=(const Address &other) const {
@@ -77,30 +84,39 @@ public:
     }
 
     AF_FORCEINLINE bool operator<(const Address &other) const {
-        return (name_ < other.name_);
+        return (index_ < other.index_);
     }
 
 private:
     /*
      * Internal explicit constructor, used by friend classes.
      */
-    AF_FORCEINLINE explicit Address(const Detail::String &name, const Detail::Index &index) 
-      : name_(name),
-        index_(index) {
-    }
-
-    AF_FORCEINLINE const Detail::String &GetName() const {
-        return name_;
+    AF_FORCEINLINE explicit Address(const Detail::Index &index) : index_(index) {
     }
 
     static Address null_address_;       // A single static instance of the null address.
 
-    Detail::String name_;               // The string name of the addressed entity.
-    Detail::Index index_;               // Cached local framework and index.
+    Detail::Index index_;               // Framework, index within the framework and generation of the addressed entity.
 };
 
 
 } // namespace AF
 
 
+namespace std
+{
+
+/*
+ * Hashes addresses by their indices, so they can be used as keys of unordered containers.
+ */
+template <>
+struct hash<AF::Address> {
+    AF_FORCEINLINE size_t operator()(const AF::Address &address) const {
+        return hash<uint64_t>()(address.AsUInt64());
+    }
+};
+
+} // namespace std
+
+
 #endif // AF_ADDRESS_H
@@ -6,7 +6,7 @@
 #include "AF/default_allocator.h"
 #include "AF/defines.h"
 
-#include "AF/detail/allocators/caching_allocator.h"
+#include "AF/detail/allocators/size_class_allocator.h"
 
 #include "AF/detail/threading/spin_lock.h"
 
@@ -28,6 +28,16 @@ public:
         return &cache_;
     }
 
+    // Sets the maximum number of free blocks the cache keeps for the size class holding the given size.
+    AF_FORCEINLINE static void SetCacheDepth(const uint32_t size, const uint32_t max_blocks) {
+        cache_.SetMaxBlocks(size, max_blocks);
+    }
+
+    // Gets the hit, miss and eviction counts of the caching allocator.
+    AF_FORCEINLINE static Detail::AllocatorStatistics GetCacheStatistics() {
+        return cache_.GetStatistics();
+    }
+
 private:
     struct CacheTraits {
         typedef Detail::SpinLock LockType;
@@ -35,11 +45,10 @@ private:
         struct AF_PREALIGN(AF_CACHELINE_ALIGNMENT) AlignType {
         } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
 
-        static const uint32_t MAX_POOLS = 8;
         static const uint32_t MAX_BLOCKS = 16;
     };
 
-    typedef Detail::CachingAllocator<CacheTraits> CacheType;
+    typedef Detail::SizeClassAllocator<CacheTraits> CacheType;
 
     AF_FORCEINLINE AllocatorManager() {
     }
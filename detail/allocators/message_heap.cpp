@@ -0,0 +1,211 @@
+#include "AF/detail/allocators/message_heap.h"
+
+#include <new>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+
+MessageHeap *MessageHeap::Create(const bool thread_safe) {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    void *const memory(allocator->AllocateAligned(sizeof(MessageHeap), AF_CACHELINE_ALIGNMENT));
+    AF_ASSERT_MSG(memory, "Failed to allocate message heap");
+
+    return new (memory) MessageHeap(thread_safe);
+}
+
+MessageHeap::MessageHeap(const bool thread_safe)
+  : thread_safe_(thread_safe),
+    lock_(),
+    extents_(),
+    batches_(),
+    slabs_(0),
+    allocated_(0),
+    orphaned_(0),
+    remote_(0) {
+    static_assert(sizeof(BlockHeader) <= HEADER_SIZE, "Block header doesn't fit in its reserved space");
+    static_assert(sizeof(FreeNode) <= HEADER_SIZE, "Free list node doesn't fit in the smallest slot");
+
+    for (uint32_t index = 0; index < SizeClasses::NUM_CLASSES; ++index) {
+        free_[index] = 0;
+    }
+}
+
+MessageHeap::~MessageHeap() {
+}
+
+void MessageHeap::Release() {
+    Lock();
+
+    // Return any blocks of other heaps that we're still holding.
+    for (uint32_t index = 0; index < PENDING_BATCHES; ++index) {
+        Flush(batches_[index]);
+    }
+
+    // Record how many of our slots are still out, then mark the heap as released while
+    // taking the slots already returned. Threads that find the heap released decrement
+    // the balance instead, so whoever takes it to zero knows the heap is unused.
+    orphaned_.store(allocated_, std::memory_order_relaxed);
+    uintptr_t remote(remote_.exchange(RELEASED, std::memory_order_acq_rel));
+
+    uint32_t count(0);
+    while (remote) {
+        ++count;
+        remote = reinterpret_cast<uintptr_t>(reinterpret_cast<FreeNode *>(remote)->next_);
+    }
+
+    Unlock();
+
+    if (orphaned_.fetch_sub(count, std::memory_order_acq_rel) == count) {
+        Destroy();
+    }
+}
+
+MessageHeap::FreeNode *MessageHeap::Refill(const uint32_t size_class) {
+    // Take back any blocks returned by other heaps before carving new ones.
+    if (remote_.load(std::memory_order_relaxed) != 0) {
+        CollectRemote();
+
+        if (FreeNode *const node = free_[size_class]) {
+            free_[size_class] = node->next_;
+            return node;
+        }
+    }
+
+    const uint32_t slot_size(SizeClasses::GetSize(size_class) + HEADER_SIZE);
+    Extent &extent(extents_[size_class]);
+
+    // Start a new slab when there's no room left in the current one.
+    if (extent.next_ + slot_size > extent.end_) {
+        AllocatorInterface *const allocator(AllocatorManager::GetCache());
+        void *const memory(allocator->AllocateAligned(SLAB_SIZE, AF_CACHELINE_ALIGNMENT));
+        if (memory == 0) {
+            return 0;
+        }
+
+        Slab *const slab(reinterpret_cast<Slab *>(memory));
+        slab->next_ = slabs_;
+        slabs_ = slab;
+
+        // Slots start after the slab header, at a 16-byte boundary.
+        extent.next_ = reinterpret_cast<uint8_t *>(memory) + HEADER_SIZE;
+        extent.end_ = reinterpret_cast<uint8_t *>(memory) + SLAB_SIZE;
+    }
+
+    FreeNode *const node(reinterpret_cast<FreeNode *>(extent.next_));
+    extent.next_ += slot_size;
+
+    return node;
+}
+
+void MessageHeap::CollectRemote() {
+    uintptr_t remote(remote_.exchange(0, std::memory_order_acquire));
+    AF_ASSERT(remote != RELEASED);
+
+    while (remote) {
+        FreeNode *const node(reinterpret_cast<FreeNode *>(remote));
+        remote = reinterpret_cast<uintptr_t>(node->next_);
+
+        node->next_ = free_[node->size_class_];
+        free_[node->size_class_] = node;
+        --allocated_;
+    }
+}
+
+void MessageHeap::FreeRemote(MessageHeap *const heap, FreeNode *const node) {
+    // Batches are keyed on the owning heap, which are cacheline-aligned.
+    Batch &batch(batches_[(reinterpret_cast<uintptr_t>(heap) / AF_CACHELINE_ALIGNMENT) % PENDING_BATCHES]);
+
+    if (batch.heap_ != heap) {
+        Flush(batch);
+        batch.heap_ = heap;
+    }
+
+    node->next_ = batch.first_;
+    batch.first_ = node;
+    if (batch.last_ == 0) {
+        batch.last_ = node;
+    }
+
+    if (++batch.count_ == BATCH_SIZE) {
+        Flush(batch);
+    }
+}
+
+void MessageHeap::Flush(Batch &batch) {
+    if (batch.count_ == 0) {
+        return;
+    }
+
+    MessageHeap *const heap(batch.heap_);
+    FreeNode *const first(batch.first_);
+    FreeNode *const last(batch.last_);
+    const uint32_t count(batch.count_);
+
+    batch.first_ = 0;
+    batch.last_ = 0;
+    batch.count_ = 0;
+
+    // Push the whole batch onto the owner's remote list.
+    uintptr_t remote(heap->remote_.load(std::memory_order_acquire));
+    while (remote != RELEASED) {
+        last->next_ = reinterpret_cast<FreeNode *>(remote);
+        if (heap->remote_.compare_exchange_weak(
+            remote,
+            reinterpret_cast<uintptr_t>(first),
+            std::memory_order_release,
+            std::memory_order_acquire)) {
+            return;
+        }
+    }
+
+    // The owner has released the heap, so settle the balance instead.
+    if (heap->orphaned_.fetch_sub(count, std::memory_order_acq_rel) == count) {
+        heap->Destroy();
+    }
+}
+
+void *MessageHeap::AllocateLarge(const SizeType size, const SizeType alignment) {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    // Reserve room in front of the block for the header, keeping the block aligned.
+    const uint32_t block_alignment(alignment > HEADER_SIZE ? alignment : HEADER_SIZE);
+    uint8_t *const memory(reinterpret_cast<uint8_t *>(allocator->AllocateAligned(size + block_alignment, block_alignment)));
+    if (memory == 0) {
+        return 0;
+    }
+
+    uint8_t *const block(memory + block_alignment);
+    BlockHeader *const header(GetHeader(block));
+    header->heap_ = 0;
+    header->size_class_ = LARGE_CLASS;
+    header->offset_ = block_alignment;
+
+    return block;
+}
+
+void MessageHeap::FreeLarge(void *const block) {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+    allocator->Free(reinterpret_cast<uint8_t *>(block) - GetHeader(block)->offset_);
+}
+
+void MessageHeap::Destroy() {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    while (slabs_) {
+        Slab *const slab(slabs_);
+        slabs_ = slab->next_;
+        allocator->FreeWithSize(slab, SLAB_SIZE);
+    }
+
+    this->~MessageHeap();
+    allocator->FreeWithSize(this, sizeof(MessageHeap));
+}
+
+
+} // namespace Detail
+} // namespace AF
@@ -0,0 +1,262 @@
+#ifndef AF_DETAIL_ALLOCATORS_MESSAGEHEAP_H
+#define AF_DETAIL_ALLOCATORS_MESSAGEHEAP_H
+
+#include "AF/align.h"
+#include "AF/allocator_interface.h"
+#include "AF/allocator_manager.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include "AF/detail/allocators/size_classes.h"
+
+#include "AF/detail/threading/spin_lock.h"
+
+#include <atomic>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * A slab-based message allocator owned by a single thread.
+ *
+ * Each heap carves blocks of fixed size classes out of slabs that it owns, and prefixes every
+ * block with a small header naming the heap that allocated it. Blocks freed by the owning thread
+ * go straight back onto the heap's free lists. Blocks freed by any other heap are collected into
+ * per-owner batches and returned to their owner in one atomic push, onto a remote free list that
+ * the owner drains when its free lists run dry. So messages sent along a pipeline are recycled by
+ * their sender instead of piling up in the receiving thread's cache.
+ *
+ * Heaps are created with Create and given up with Release. A released heap with blocks still in
+ * flight stays alive, and is destroyed by whichever thread returns its last block.
+ *
+ * Thread-safe heaps lock around all owner-side operations and can be shared by many threads.
+ */
+class MessageHeap : public AllocatorInterface {
+public:
+    /*
+     * Creates a heap. Heaps that aren't thread-safe may only be used by one thread at a time.
+     */
+    static MessageHeap *Create(const bool thread_safe);
+
+    /*
+     * Gives up ownership of the heap. The heap mustn't be used for allocation after this call.
+     */
+    void Release();
+
+    inline virtual void *Allocate(const SizeType size);
+
+    inline virtual void *AllocateAligned(const SizeType size, const SizeType alignment);
+
+    inline virtual void Free(void *const block) override;
+
+    inline virtual void FreeWithSize(void *const block, const SizeType size) override;
+
+private:
+    static const uint32_t SLAB_SIZE = 16384;        // Size of the slabs from which blocks are carved.
+    static const uint32_t HEADER_SIZE = 16;         // Size of the header preceding each block.
+    static const uint32_t LARGE_CLASS = SizeClasses::NUM_CLASSES;
+    static const uint32_t PENDING_BATCHES = 8;      // Number of remote batches buffered at a time.
+    static const uint32_t BATCH_SIZE = 32;          // Number of blocks returned to their owner at once.
+    static const uintptr_t RELEASED = 1;            // Marks the remote list of a released heap.
+
+    /*
+     * Header stored immediately before each allocated block.
+     */
+    struct BlockHeader {
+        MessageHeap *heap_;         // Heap that allocated the block.
+        uint32_t size_class_;       // Size class of the block, or LARGE_CLASS.
+        uint32_t offset_;           // Offset of the block from the start of its slot.
+    };
+
+    /*
+     * A free slot, linked in place within the memory it represents.
+     */
+    struct FreeNode {
+        FreeNode *next_;            // Next free slot in the list.
+        uint32_t size_class_;       // Size class of the slot.
+    };
+
+    /*
+     * Header at the start of each slab, linking all the slabs owned by the heap.
+     */
+    struct Slab {
+        Slab *next_;
+    };
+
+    /*
+     * A batch of slots freed by this heap that belong to another heap.
+     */
+    struct Batch {
+        inline Batch() : heap_(0), first_(0), last_(0), count_(0) {
+        }
+
+        MessageHeap *heap_;
+        FreeNode *first_;
+        FreeNode *last_;
+        uint32_t count_;
+    };
+
+    /*
+     * Unused part of the last slab carved for a size class.
+     */
+    struct Extent {
+        inline Extent() : next_(0), end_(0) {
+        }
+
+        uint8_t *next_;
+        uint8_t *end_;
+    };
+
+    explicit MessageHeap(const bool thread_safe);
+    ~MessageHeap();
+
+    MessageHeap(const MessageHeap &other);
+    MessageHeap &operator=(const MessageHeap &other);
+
+    inline void Lock();
+    inline void Unlock();
+
+    inline static BlockHeader *GetHeader(void *const block);
+
+    /*
+     * Allocates a slot when the free list of the size class is empty.
+     */
+    FreeNode *Refill(const uint32_t size_class);
+
+    /*
+     * Moves all blocks returned by other heaps onto the free lists.
+     */
+    void CollectRemote();
+
+    /*
+     * Adds a slot belonging to another heap to the batch for that heap.
+     */
+    void FreeRemote(MessageHeap *const heap, FreeNode *const node);
+
+    /*
+     * Returns a batch of slots to the heap that owns them.
+     */
+    static void Flush(Batch &batch);
+
+    void *AllocateLarge(const SizeType size, const SizeType alignment);
+    static void FreeLarge(void *const block);
+
+    void Destroy();
+
+    const bool thread_safe_;                        // Whether owner-side operations are locked.
+    SpinLock lock_;                                 // Protects thread-safe heaps.
+    FreeNode *free_[SizeClasses::NUM_CLASSES];      // Per-class lists of free slots.
+    Extent extents_[SizeClasses::NUM_CLASSES];      // Per-class uncarved slab space.
+    Batch batches_[PENDING_BATCHES];                // Slots waiting to be returned to other heaps.
+    Slab *slabs_;                                   // List of slabs owned by the heap.
+    uint32_t allocated_;                            // Number of slots allocated and not yet seen freed.
+    std::atomic<uint32_t> orphaned_;                // Slots still in flight after release.
+    std::atomic<uintptr_t> remote_;                 // Slots returned by other heaps, or RELEASED.
+};
+
+
+AF_FORCEINLINE void *MessageHeap::Allocate(const SizeType size) {
+    return AllocateAligned(size, sizeof(void *));
+}
+
+AF_FORCEINLINE void *MessageHeap::AllocateAligned(const SizeType size, const SizeType alignment) {
+    AF_ASSERT((alignment & (alignment - 1)) == 0);
+
+    // Blocks follow a 16-byte header, so larger alignments need padding within the slot.
+    const uint32_t padding(alignment > HEADER_SIZE ? alignment - HEADER_SIZE : 0);
+    const uint32_t size_class(SizeClasses::GetClass(size + padding));
+
+    if (size_class == LARGE_CLASS) {
+        return AllocateLarge(size, alignment);
+    }
+
+    Lock();
+
+    FreeNode *node(free_[size_class]);
+    if (node) {
+        free_[size_class] = node->next_;
+    } else {
+        node = Refill(size_class);
+    }
+
+    if (node) {
+        ++allocated_;
+    }
+
+    Unlock();
+
+    if (node == 0) {
+        return 0;
+    }
+
+    uint8_t *block(reinterpret_cast<uint8_t *>(node) + HEADER_SIZE);
+    AF_ALIGN(block, alignment);
+
+    BlockHeader *const header(GetHeader(block));
+    header->heap_ = this;
+    header->size_class_ = size_class;
+    header->offset_ = static_cast<uint32_t>(block - reinterpret_cast<uint8_t *>(node));
+
+    return block;
+}
+
+AF_FORCEINLINE void MessageHeap::Free(void *const block) {
+    AF_ASSERT(block);
+
+    // Read the header before the slot is overwritten by its free list node.
+    BlockHeader *const header(GetHeader(block));
+    MessageHeap *const heap(header->heap_);
+    const uint32_t size_class(header->size_class_);
+
+    if (size_class == LARGE_CLASS) {
+        FreeLarge(block);
+        return;
+    }
+
+    FreeNode *const node(reinterpret_cast<FreeNode *>(reinterpret_cast<uint8_t *>(block) - header->offset_));
+    node->size_class_ = size_class;
+
+    Lock();
+
+    if (heap == this) {
+        node->next_ = free_[size_class];
+        free_[size_class] = node;
+        --allocated_;
+    } else {
+        FreeRemote(heap, node);
+    }
+
+    Unlock();
+}
+
+AF_FORCEINLINE void MessageHeap::FreeWithSize(void *const block, const SizeType /* size */) {
+    // The block header records everything we need.
+    Free(block);
+}
+
+AF_FORCEINLINE void MessageHeap::Lock() {
+    if (thread_safe_) {
+        lock_.Lock();
+    }
+}
+
+AF_FORCEINLINE void MessageHeap::Unlock() {
+    if (thread_safe_) {
+        lock_.Unlock();
+    }
+}
+
+AF_FORCEINLINE MessageHeap::BlockHeader *MessageHeap::GetHeader(void *const block) {
+    return reinterpret_cast<BlockHeader *>(reinterpret_cast<uint8_t *>(block) - HEADER_SIZE);
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_ALLOCATORS_MESSAGEHEAP_H
@@ -14,6 +14,10 @@ namespace Detail
 
 /*
  * A pool of free memory blocks.
+ *
+ * Blocks are kept in separate lists according to the alignment of their addresses, with a mask
+ * recording which lists are non-empty. Fetching a block with a given alignment takes the first
+ * block from the least-aligned list that satisfies it, without searching the lists.
  */
 template <uint32_t MAX_BLOCKS>
 class Pool {
@@ -22,6 +26,11 @@ public:
 
     inline bool Empty() const;
 
+    /*
+     * Returns the number of blocks currently cached in the pool.
+     */
+    inline uint32_t Count() const;
+
     inline bool Add(void *memory);
 
     /*
@@ -37,6 +46,10 @@ public:
     inline void *Fetch();
 
 private:
+    // Number of alignment lists. The last list holds all blocks aligned to at least
+    // 2^(NUM_LISTS - 1) bytes, so larger alignments need a search of that list.
+    static const uint32_t NUM_LISTS = 12;
+
     /*
      * A node representing a free memory block within the pool.
      * Nodes are created in-place within the free blocks they represent.
@@ -48,34 +61,54 @@ private:
         Node *next_;        // Pointer to next node in a list.
     };
 
-    Node head_;             // Dummy node at head of a linked list of nodes in the pool.
-    uint32_t block_count_;  // Number of blocks currently cached in the pool.
+    /*
+     * Returns the index of the list holding blocks with the given alignment, or address.
+     */
+    inline static uint32_t GetList(const uintptr_t value);
+
+    inline void *Pop(const uint32_t list);
+
+    inline void *Search(const uint32_t alignment);
+
+    Node *heads_[NUM_LISTS];    // Lists of nodes in the pool, by alignment.
+    uint32_t non_empty_;        // Bitmask of the lists that aren't empty.
+    uint32_t block_count_;      // Number of blocks currently cached in the pool.
 };
 
 
 template <uint32_t MAX_BLOCKS>
 AF_FORCEINLINE Pool<MAX_BLOCKS>::Pool() 
-  : head_(),
+  : non_empty_(0),
     block_count_(0) {
+    for (uint32_t list = 0; list < NUM_LISTS; ++list) {
+        heads_[list] = 0;
+    }
 }
 
 template <uint32_t MAX_BLOCKS>
 AF_FORCEINLINE bool Pool<MAX_BLOCKS>::Empty() const {
-    AF_ASSERT((block_count_ == 0 && head_.next_ == 0) || (block_count_ != 0 && head_.next_ != 0));
+    AF_ASSERT((block_count_ == 0 && non_empty_ == 0) || (block_count_ != 0 && non_empty_ != 0));
     return (block_count_ == 0);
 }
 
+template <uint32_t MAX_BLOCKS>
+AF_FORCEINLINE uint32_t Pool<MAX_BLOCKS>::Count() const {
+    return block_count_;
+}
+
 template <uint32_t MAX_BLOCKS>
 AF_FORCEINLINE bool Pool<MAX_BLOCKS>::Add(void *const memory) {
     AF_ASSERT(memory);
 
     // Below maximum block count limit?
     if (block_count_ < MAX_BLOCKS) {
-        // Just call it a node and link it in.
+        // Just call it a node and link it into the list for its alignment.
         Node *const node(reinterpret_cast<Node *>(memory));
+        const uint32_t list(GetList(reinterpret_cast<uintptr_t>(memory)));
 
-        node->next_ = head_.next_;
-        head_.next_ = node;
+        node->next_ = heads_[list];
+        heads_[list] = node;
+        non_empty_ |= (1U << list);
 
         ++block_count_;
         return true;
@@ -86,24 +119,19 @@ AF_FORCEINLINE bool Pool<MAX_BLOCKS>::Add(void *const memory) {
 
 template <uint32_t MAX_BLOCKS>
 AF_FORCEINLINE void *Pool<MAX_BLOCKS>::FetchAligned(const uint32_t alignment) {
-    Node *previous(&head_);
-    const uint32_t alignment_mask(alignment - 1);
+    AF_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
 
-    // Search the block list.
-    Node *node(head_.next_);
-    while (node) {
-        Node *const next(node->next_);
-
-        if ((reinterpret_cast<uintptr_t>(node) & alignment_mask) == 0) {
-            // Remove from list and return as a block.
-            previous->next_ = next;
-            --block_count_;
+    const uint32_t list(GetList(alignment));
 
-            return reinterpret_cast<void *>(node);
-        }
+    // Alignments beyond the last list can only be found by checking addresses.
+    if (list == NUM_LISTS - 1 && alignment != (1U << list)) {
+        return Search(alignment);
+    }
 
-        previous = node;
-        node = next;
+    // Any block in this list or a later one has at least the required alignment.
+    const uint32_t candidates(non_empty_ & ~((1U << list) - 1));
+    if (candidates) {
+        return Pop(static_cast<uint32_t>(__builtin_ctz(candidates)));
     }
 
     // 0 result indicates no correctly aligned block available.
@@ -112,19 +140,57 @@ AF_FORCEINLINE void *Pool<MAX_BLOCKS>::FetchAligned(const uint32_t alignment) {
 
 template <uint32_t MAX_BLOCKS>
 AF_FORCEINLINE void *Pool<MAX_BLOCKS>::Fetch() {
-    // Grab first block in the list if the list isn't empty.
-    Node *const node(head_.next_);
-    if (node) {
-        head_.next_ = node->next_;
-        --block_count_;
-
-        return reinterpret_cast<void *>(node);
+    // Grab a block from the least-aligned list, saving better-aligned blocks for aligned fetches.
+    if (non_empty_) {
+        return Pop(static_cast<uint32_t>(__builtin_ctz(non_empty_)));
     }
 
     // 0 result indicates no block available.
     return 0;
 }
 
+template <uint32_t MAX_BLOCKS>
+AF_FORCEINLINE uint32_t Pool<MAX_BLOCKS>::GetList(const uintptr_t value) {
+    // The alignment of an address is its lowest set bit, capped at the last list.
+    const unsigned long long bits(static_cast<unsigned long long>(value) | (1ULL << (NUM_LISTS - 1)));
+    return static_cast<uint32_t>(__builtin_ctzll(bits));
+}
+
+template <uint32_t MAX_BLOCKS>
+AF_FORCEINLINE void *Pool<MAX_BLOCKS>::Pop(const uint32_t list) {
+    Node *const node(heads_[list]);
+    AF_ASSERT(node);
+
+    Node *const next(node->next_);
+    heads_[list] = next;
+    non_empty_ &= ~(static_cast<uint32_t>(next == 0) << list);
+
+    --block_count_;
+    return reinterpret_cast<void *>(node);
+}
+
+template <uint32_t MAX_BLOCKS>
+inline void *Pool<MAX_BLOCKS>::Search(const uint32_t alignment) {
+    const uint32_t alignment_mask(alignment - 1);
+
+    Node **link(&heads_[NUM_LISTS - 1]);
+    while (Node *const node = *link) {
+        if ((reinterpret_cast<uintptr_t>(node) & alignment_mask) == 0) {
+            *link = node->next_;
+            if (heads_[NUM_LISTS - 1] == 0) {
+                non_empty_ &= ~(1U << (NUM_LISTS - 1));
+            }
+
+            --block_count_;
+            return reinterpret_cast<void *>(node);
+        }
+
+        link = &node->next_;
+    }
+
+    return 0;
+}
+
 
 } // namespace Detail
 } // namespace AF
@@ -0,0 +1,284 @@
+#ifndef AF_DETAIL_ALLOCATORS_SIZECLASSALLOCATOR_H
+#define AF_DETAIL_ALLOCATORS_SIZECLASSALLOCATOR_H
+
+#include "AF/align.h"
+#include "AF/allocator_interface.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include "AF/detail/allocators/caching_allocator.h"
+#include "AF/detail/allocators/pool.h"
+#include "AF/detail/allocators/size_classes.h"
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * Counts of cache events recorded by a SizeClassAllocator.
+ */
+struct AllocatorStatistics {
+    inline AllocatorStatistics() : hits_(0), misses_(0), evictions_(0) {
+    }
+
+    uint32_t hits_;             // Allocations served from the cache.
+    uint32_t misses_;           // Allocations passed on to the wrapped allocator.
+    uint32_t evictions_;        // Freed blocks passed on to the wrapped allocator because their pool was full.
+};
+
+
+/*
+ * A caching allocator that caches free memory blocks by size class.
+ *
+ * Unlike CachingAllocator, which keeps a small number of pools for exact block sizes and searches
+ * them in turn, every size up to SizeClasses::MAX_SIZE maps directly to the pool of its size class.
+ * Blocks are allocated at the size of their class so any cached block can serve any size in the
+ * class. Larger sizes aren't cached.
+ *
+ * Each size class has its own pool depth, which defaults to CacheTraits::MAX_BLOCKS and can be
+ * set per class, either with an array of depths at construction or later with SetMaxBlocks.
+ */
+template <class CacheTraits = DefaultCacheTraits>
+class SizeClassAllocator : public AF::AllocatorInterface {
+public:
+    inline SizeClassAllocator();
+
+    inline explicit SizeClassAllocator(AllocatorInterface *const allocator);
+
+    /*
+     * Constructs an allocator with the given pool depth for each size class.
+     * The array is indexed by size class and holds SizeClasses::NUM_CLASSES entries.
+     */
+    inline SizeClassAllocator(AllocatorInterface *const allocator, const uint32_t *const max_blocks);
+
+    inline virtual ~SizeClassAllocator();
+
+    inline void SetAllocator(AllocatorInterface *const allocator);
+
+    inline AllocatorInterface *GetAllocator() const;
+
+    inline virtual void *Allocate(const uint32_t size);
+
+    inline virtual void *AllocateAligned(const uint32_t size, const uint32_t alignment);
+
+    inline virtual void Free(void *const block) override;
+
+    inline virtual void FreeWithSize(void *const block, const SizeType size) override;
+
+    inline void Clear();
+
+    /*
+     * Sets the maximum number of free blocks cached for the size class holding the given size.
+     * Blocks beyond the new depth are freed. Sizes too large for any class are ignored.
+     */
+    inline void SetMaxBlocks(const uint32_t size, const uint32_t max_blocks);
+
+    /*
+     * Gets the maximum number of free blocks cached for the size class holding the given size.
+     * Returns zero for sizes too large for any class.
+     */
+    inline uint32_t GetMaxBlocks(const uint32_t size) const;
+
+    /*
+     * Gets the cache statistics recorded since the allocator was created.
+     */
+    inline AllocatorStatistics GetStatistics() const;
+
+private:
+    class Entry {
+    public:
+        // The pool itself is unbounded; its depth is limited by max_blocks_.
+        typedef Detail::Pool<0xFFFFFFFF> PoolType;
+
+        AF_FORCEINLINE Entry() : max_blocks_(CacheTraits::MAX_BLOCKS) {
+        }
+
+        typename CacheTraits::AlignType align_;
+        PoolType pool_;
+        uint32_t max_blocks_;       // Maximum number of blocks cached in the pool.
+    };
+
+    SizeClassAllocator(const SizeClassAllocator &other);
+    SizeClassAllocator &operator=(const SizeClassAllocator &other);
+
+    AllocatorInterface *allocator_;                     // pointer to a wrapped low-level allocator.
+    mutable typename CacheTraits::LockType lock_;       // protects access to the pools and statistics.
+    Entry entries_[SizeClasses::NUM_CLASSES];           // pools of memory blocks, one per size class.
+    AllocatorStatistics statistics_;                    // counts of cache hits, misses and evictions.
+};
+
+
+template <class CacheTraits>
+AF_FORCEINLINE SizeClassAllocator<CacheTraits>::SizeClassAllocator()
+  : allocator_(0) {
+}
+
+template <class CacheTraits>
+AF_FORCEINLINE SizeClassAllocator<CacheTraits>::SizeClassAllocator(AllocatorInterface *const allocator)
+  : allocator_(allocator) {
+}
+
+template <class CacheTraits>
+inline SizeClassAllocator<CacheTraits>::SizeClassAllocator(
+    AllocatorInterface *const allocator,
+    const uint32_t *const max_blocks)
+  : allocator_(allocator) {
+    AF_ASSERT(max_blocks);
+
+    for (uint32_t index = 0; index < SizeClasses::NUM_CLASSES; ++index) {
+        entries_[index].max_blocks_ = max_blocks[index];
+    }
+}
+
+template <class CacheTraits>
+AF_FORCEINLINE SizeClassAllocator<CacheTraits>::~SizeClassAllocator() {
+    Clear();
+}
+
+template <class CacheTraits>
+inline void SizeClassAllocator<CacheTraits>::SetAllocator(AllocatorInterface *const allocator) {
+    allocator_ = allocator;
+}
+
+template <class CacheTraits>
+inline AllocatorInterface *SizeClassAllocator<CacheTraits>::GetAllocator() const {
+    return allocator_;
+}
+
+template <class CacheTraits>
+inline void *SizeClassAllocator<CacheTraits>::Allocate(const uint32_t size) {
+    return AllocateAligned(size, sizeof(void *));
+}
+
+template <class CacheTraits>
+inline void *SizeClassAllocator<CacheTraits>::AllocateAligned(const uint32_t size, const uint32_t alignment) {
+    // Alignment values are expected to be powers of two and at least 4 bytes.
+    AF_ASSERT(alignment >= 4);
+    AF_ASSERT((alignment & (alignment - 1)) == 0);
+
+    const uint32_t size_class(SizeClasses::GetClass(size));
+    void *block(0);
+
+    // Sizes too large for any class aren't cached.
+    if (size_class == SizeClasses::NUM_CLASSES) {
+        return allocator_->AllocateAligned(size, alignment);
+    }
+
+    lock_.Lock();
+
+    block = entries_[size_class].pool_.FetchAligned(alignment);
+    if (block) {
+        ++statistics_.hits_;
+    } else {
+        ++statistics_.misses_;
+    }
+
+    lock_.Unlock();
+
+    if (block == 0) {
+        // Allocate a new block at the full size of its class, so it can be reused for any size in the class.
+        block = allocator_->AllocateAligned(SizeClasses::GetSize(size_class), alignment);
+    }
+
+    return block;
+}
+
+template <class CacheTraits>
+inline void SizeClassAllocator<CacheTraits>::Free(void *const block) {
+    // We don't try to cache blocks of unknown size.
+    allocator_->Free(block);
+}
+
+template <class CacheTraits>
+inline void SizeClassAllocator<CacheTraits>::FreeWithSize(void *const block, const SizeType size) {
+    AF_ASSERT(block);
+
+    const uint32_t size_class(SizeClasses::GetClass(size));
+    if (size_class == SizeClasses::NUM_CLASSES) {
+        allocator_->FreeWithSize(block, size);
+        return;
+    }
+
+    lock_.Lock();
+
+    // Try to add the block to the pool of its class, if it's not already full.
+    Entry &entry(entries_[size_class]);
+    const bool added(entry.pool_.Count() < entry.max_blocks_ && entry.pool_.Add(block));
+    if (!added) {
+        ++statistics_.evictions_;
+    }
+
+    lock_.Unlock();
+
+    if (!added) {
+        allocator_->FreeWithSize(block, SizeClasses::GetSize(size_class));
+    }
+}
+
+template <class CacheTraits>
+inline void SizeClassAllocator<CacheTraits>::Clear() {
+    lock_.Lock();
+
+    // Free any remaining blocks in the pools.
+    for (uint32_t index = 0; index < SizeClasses::NUM_CLASSES; ++index) {
+        Entry &entry(entries_[index]);
+        while (!entry.pool_.Empty()) {
+            allocator_->FreeWithSize(entry.pool_.Fetch(), SizeClasses::GetSize(index));
+        }
+    }
+
+    lock_.Unlock();
+}
+
+template <class CacheTraits>
+inline void SizeClassAllocator<CacheTraits>::SetMaxBlocks(const uint32_t size, const uint32_t max_blocks) {
+    const uint32_t size_class(SizeClasses::GetClass(size));
+    if (size_class == SizeClasses::NUM_CLASSES) {
+        return;
+    }
+
+    lock_.Lock();
+
+    // Free any blocks beyond the new depth.
+    Entry &entry(entries_[size_class]);
+    entry.max_blocks_ = max_blocks;
+
+    while (entry.pool_.Count() > max_blocks) {
+        allocator_->FreeWithSize(entry.pool_.Fetch(), SizeClasses::GetSize(size_class));
+    }
+
+    lock_.Unlock();
+}
+
+template <class CacheTraits>
+inline uint32_t SizeClassAllocator<CacheTraits>::GetMaxBlocks(const uint32_t size) const {
+    const uint32_t size_class(SizeClasses::GetClass(size));
+    if (size_class == SizeClasses::NUM_CLASSES) {
+        return 0;
+    }
+
+    lock_.Lock();
+    const uint32_t max_blocks(entries_[size_class].max_blocks_);
+    lock_.Unlock();
+
+    return max_blocks;
+}
+
+template <class CacheTraits>
+inline AllocatorStatistics SizeClassAllocator<CacheTraits>::GetStatistics() const {
+    lock_.Lock();
+    const AllocatorStatistics statistics(statistics_);
+    lock_.Unlock();
+
+    return statistics;
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_ALLOCATORS_SIZECLASSALLOCATOR_H
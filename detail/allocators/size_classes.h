@@ -0,0 +1,80 @@
+#ifndef AF_DETAIL_ALLOCATORS_SIZECLASSES_H
+#define AF_DETAIL_ALLOCATORS_SIZECLASSES_H
+
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * Maps allocation sizes to a fixed set of size classes.
+ *
+ * Sizes up to 128 bytes are rounded up to a multiple of 16 bytes. Larger sizes are split into
+ * four classes per power of two, so rounding never wastes more than a fifth of a block.
+ * Sizes above MAX_SIZE have no class and are reported as NUM_CLASSES.
+ */
+class SizeClasses {
+public:
+    static const uint32_t NUM_CLASSES = 28;     // Number of size classes.
+    static const uint32_t MAX_SIZE = 4096;      // Block size of the largest size class.
+
+    /*
+     * Returns the index of the smallest size class that fits the given size,
+     * or NUM_CLASSES if the size is larger than MAX_SIZE.
+     */
+    inline static uint32_t GetClass(const uint32_t size);
+
+    /*
+     * Returns the block size of the given size class.
+     */
+    inline static uint32_t GetSize(const uint32_t size_class);
+
+private:
+    static const uint32_t SMALL_CLASSES = 8;    // Number of classes in 16-byte steps.
+    static const uint32_t SMALL_SHIFT = 4;      // Log2 of the small class step.
+    static const uint32_t SMALL_MAX_BITS = 7;   // Log2 of the size of the largest small class.
+};
+
+
+AF_FORCEINLINE uint32_t SizeClasses::GetClass(const uint32_t size) {
+    if (size <= (SMALL_CLASSES << SMALL_SHIFT)) {
+        return size > 0 ? ((size - 1) >> SMALL_SHIFT) : 0;
+    }
+
+    if (size > MAX_SIZE) {
+        return NUM_CLASSES;
+    }
+
+    // Find the power of two below the size, then which quarter of the doubling it falls in.
+    const uint32_t value(size - 1);
+    const uint32_t bits(31 - static_cast<uint32_t>(__builtin_clz(value)));
+    const uint32_t quarter((value >> (bits - 2)) & 3);
+
+    return SMALL_CLASSES + ((bits - SMALL_MAX_BITS) << 2) + quarter;
+}
+
+AF_FORCEINLINE uint32_t SizeClasses::GetSize(const uint32_t size_class) {
+    AF_ASSERT(size_class < NUM_CLASSES);
+
+    if (size_class < SMALL_CLASSES) {
+        return (size_class + 1) << SMALL_SHIFT;
+    }
+
+    const uint32_t index(size_class - SMALL_CLASSES);
+    const uint32_t bits(SMALL_MAX_BITS + (index >> 2));
+    const uint32_t quarter(index & 3);
+
+    return (1U << bits) + ((quarter + 1) << (bits - 2));
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_ALLOCATORS_SIZECLASSES_H
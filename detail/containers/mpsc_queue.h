@@ -0,0 +1,158 @@
+#ifndef AF_DETAIL_CONTAINERS_MPSCQUEUE_H
+#define AF_DETAIL_CONTAINERS_MPSCQUEUE_H
+
+#include "AF/align.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include "AF/detail/utils/utils.h"
+
+#include <atomic>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * An unbounded, intrusive, lock-free multi-producer single-consumer queue.
+ *
+ * The queue is a singly-linked list with a permanent 'stub' node, after Dmitry Vyukov.
+ * Pushing is a single atomic exchange followed by a store, so is wait-free for producers.
+ * Only a single consumer thread at a time may call Front and Pop.
+ *
+ * Between its exchange and its store, a push is briefly 'in flight': the item is in the
+ * queue but not yet linked to its predecessor. The queue itself doesn't track whether it's
+ * empty; callers are expected to count items separately, and only call Front and Pop when
+ * an item is known to have been pushed. The consumer spins over in-flight pushes.
+ *
+ * The queue is intrusive and the item type is expected to derive from MpscQueue<ItemType>::Node.
+ */
+template <class ItemType>
+class MpscQueue {
+public:
+    /*
+     * Baseclass that adds link members to node types that derive from it.
+     * In order to be used with the queue, item classes must derive from Node.
+     */
+    class Node {
+    public:
+        inline Node() : next_(0) {
+        }
+
+        std::atomic<Node *> next_;      // Pointer to the next (newer) item in the queue.
+
+    private:
+        Node(const Node &other);
+        Node &operator=(const Node &other);
+    };
+
+    inline MpscQueue();
+
+    // Pushes an item onto the back of the queue. May be called by any thread.
+    inline void Push(ItemType *const item);
+
+    // Returns the item at the front of the queue without removing it.
+    // The queue must be known to be non-empty. Only the consumer may call Front.
+    inline ItemType *Front();
+
+    // Removes the item at the front of the queue, which must have been returned by Front.
+    // Only the consumer may call Pop.
+    inline void Pop();
+
+private:
+    MpscQueue(const MpscQueue &other);
+    MpscQueue &operator=(const MpscQueue &other);
+
+    inline void PushNode(Node *const node);
+
+    inline static Node *WaitNext(Node *const node);
+
+    std::atomic<Node *> head_;          // Most recently pushed node, exchanged by producers.
+    Node *tail_;                        // Oldest node still in the queue, owned by the consumer.
+    Node stub_;                         // Dummy node that keeps the list non-empty.
+};
+
+
+template <class ItemType>
+inline MpscQueue<ItemType>::MpscQueue()
+  : head_(&stub_),
+    tail_(&stub_),
+    stub_() {
+}
+
+template <class ItemType>
+AF_FORCEINLINE void MpscQueue<ItemType>::Push(ItemType *const item) {
+    PushNode(item);
+}
+
+template <class ItemType>
+AF_FORCEINLINE ItemType *MpscQueue<ItemType>::Front() {
+    Node *tail(tail_);
+
+    // Skip the stub node if it's at the front.
+    if (tail == &stub_) {
+        tail = WaitNext(tail);
+        tail_ = tail;
+    }
+
+    return static_cast<ItemType *>(tail);
+}
+
+template <class ItemType>
+AF_FORCEINLINE void MpscQueue<ItemType>::Pop() {
+    Node *const tail(tail_);
+    AF_ASSERT(tail != &stub_);
+
+    Node *next(tail->next_.load(std::memory_order_acquire));
+    if (next == 0) {
+        // If the front item is also the last then re-insert the stub behind it,
+        // so the item can be unlinked. Otherwise a later push is in flight.
+        if (head_.load(std::memory_order_acquire) == tail) {
+            PushNode(&stub_);
+        }
+
+        next = WaitNext(tail);
+    }
+
+    tail_ = next;
+}
+
+template <class ItemType>
+AF_FORCEINLINE void MpscQueue<ItemType>::PushNode(Node *const node) {
+    node->next_.store(0, std::memory_order_relaxed);
+
+    // Swing the head to the new node, then link the previous head to it.
+    Node *const previous(head_.exchange(node, std::memory_order_acq_rel));
+    previous->next_.store(node, std::memory_order_release);
+}
+
+template <class ItemType>
+AF_FORCEINLINE typename MpscQueue<ItemType>::Node *MpscQueue<ItemType>::WaitNext(Node *const node) {
+    // Spin until an in-flight push links the next node.
+    // If the pushing thread has been preempted, yield to give it chance to finish.
+    Node *next(node->next_.load(std::memory_order_acquire));
+    uint32_t spins(0);
+    uint32_t backoff(0);
+
+    while (next == 0) {
+        if (++spins < 64) {
+            Utils::Pause();
+        } else {
+            Utils::Backoff(backoff);
+        }
+
+        next = node->next_.load(std::memory_order_acquire);
+    }
+
+    return next;
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_CONTAINERS_MPSCQUEUE_H
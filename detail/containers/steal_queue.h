@@ -0,0 +1,128 @@
+#ifndef AF_DETAIL_CONTAINERS_STEALQUEUE_H
+#define AF_DETAIL_CONTAINERS_STEALQUEUE_H
+
+#include "AF/align.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include <atomic>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * A bounded, lock-free work-stealing queue.
+ *
+ * The queue is a Chase-Lev style ring buffer with a single owner and any number of thieves.
+ * Only the owning thread may push items, at the bottom. Any thread, including the owner,
+ * may take items from the top, so items are taken in the order in which they were pushed.
+ *
+ * Pushing is wait-free. Taking is lock-free: a thread that loses a race for an item retries
+ * with the next one, so Steal only returns null if the queue was seen to be empty.
+ */
+template <class ItemType, uint32_t CAPACITY>
+class StealQueue {
+public:
+    inline StealQueue();
+
+    inline ~StealQueue();
+
+    // Returns true if the queue appeared empty at the time of the call.
+    inline bool Empty() const;
+
+    // Pushes an item at the bottom of the queue. Returns false if the queue is full.
+    // Only the owning thread may call Push.
+    inline bool Push(ItemType *const item);
+
+    // Takes the item at the top of the queue, if any. May be called by any thread.
+    inline ItemType *Steal();
+
+private:
+    static const uint64_t MASK = CAPACITY - 1;
+
+    template <class ValueType>
+    struct AF_PREALIGN(AF_CACHELINE_ALIGNMENT) Aligned {
+        inline Aligned() : value_(0) {
+        }
+
+        ValueType value_;
+
+    } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
+
+    StealQueue(const StealQueue &other);
+    StealQueue &operator=(const StealQueue &other);
+
+    Aligned<std::atomic<uint64_t> > top_;       // Index of the oldest item, advanced by thieves.
+    Aligned<std::atomic<uint64_t> > bottom_;    // Index one past the newest item, advanced by the owner.
+    std::atomic<ItemType *> items_[CAPACITY];   // Ring buffer of queued items.
+};
+
+
+template <class ItemType, uint32_t CAPACITY>
+inline StealQueue<ItemType, CAPACITY>::StealQueue()
+  : top_(),
+    bottom_() {
+    // The capacity must be a power of two so the ring can be indexed by masking.
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "StealQueue capacity must be a power of two");
+
+    for (uint32_t index = 0; index < CAPACITY; ++index) {
+        items_[index].store(0, std::memory_order_relaxed);
+    }
+}
+
+template <class ItemType, uint32_t CAPACITY>
+inline StealQueue<ItemType, CAPACITY>::~StealQueue() {
+    // If the queue hasn't been emptied by the caller we'll leak the items.
+    AF_ASSERT(Empty());
+}
+
+template <class ItemType, uint32_t CAPACITY>
+AF_FORCEINLINE bool StealQueue<ItemType, CAPACITY>::Empty() const {
+    const uint64_t top(top_.value_.load(std::memory_order_acquire));
+    const uint64_t bottom(bottom_.value_.load(std::memory_order_acquire));
+    return (top >= bottom);
+}
+
+template <class ItemType, uint32_t CAPACITY>
+AF_FORCEINLINE bool StealQueue<ItemType, CAPACITY>::Push(ItemType *const item) {
+    // Only the owner writes the bottom index, so it can be read relaxed.
+    const uint64_t bottom(bottom_.value_.load(std::memory_order_relaxed));
+    const uint64_t top(top_.value_.load(std::memory_order_acquire));
+
+    if (bottom - top >= CAPACITY) {
+        return false;
+    }
+
+    // Publish the item before publishing the new bottom index.
+    items_[bottom & MASK].store(item, std::memory_order_relaxed);
+    bottom_.value_.store(bottom + 1, std::memory_order_release);
+
+    return true;
+}
+
+template <class ItemType, uint32_t CAPACITY>
+AF_FORCEINLINE ItemType *StealQueue<ItemType, CAPACITY>::Steal() {
+    uint64_t top(top_.value_.load(std::memory_order_acquire));
+
+    while (top < bottom_.value_.load(std::memory_order_acquire)) {
+        // Read the item before claiming it. If the slot is overwritten by a wrapped push
+        // then some other thread must already have claimed it, and the claim below fails.
+        ItemType *const item(items_[top & MASK].load(std::memory_order_relaxed));
+        if (top_.value_.compare_exchange_weak(top, top + 1, std::memory_order_seq_cst, std::memory_order_acquire)) {
+            return item;
+        }
+    }
+
+    return 0;
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_CONTAINERS_STEALQUEUE_H
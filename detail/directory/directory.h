@@ -8,8 +8,9 @@
 #include "AF/basic_types.h"
 #include "AF/defines.h"
 
-#include "AF/detail/threading/mutex.h"
+#include "AF/detail/directory/page_hazards.h"
 
+#include <atomic>
 #include <new>
 
 
@@ -20,6 +21,24 @@ namespace Detail
 
 /*
  * A registry that maps unique indices to addressable entities.
+ *
+ * Entries are held in pages, each with its own lock-free list of freed indices, so claiming
+ * and freeing an index are a single compare-and-swap when uncontended. Indices are claimed
+ * from the lowest page with any free, so live entries pack into the lowest pages and the
+ * others drain. Pages are allocated on demand, and reclaimed once all their indices are free,
+ * so the directory only holds the pages needed for the entities registered at once.
+ *
+ * Each page is reference-counted: every claimed index holds a reference. Threads examining an
+ * entry through a possibly stale address acquire the page first, which publishes it in one of
+ * their hazard slots rather than counting a reference, so that sends to the same page don't
+ * contend. A page is only reclaimed once nothing references it and no thread has it published,
+ * and acquiring a reclaimed page fails, which tells the caller the address is stale without
+ * touching the freed memory. The first page is never reclaimed, so is acquired for free.
+ *
+ * Each index has a generation, which is advanced whenever the index is freed. Addresses
+ * record the generation of the index they were issued for, so they can be recognized as
+ * stale once the index is reused. A reallocated page continues the generations of the page
+ * it replaces, so addresses issued for the old page stay stale.
  */
 template <class EntryType>
 class Directory {
@@ -31,37 +50,108 @@ public:
     /*
      * Finds and claims a free index for an entity.
      */
-    uint32_t Allocate(uint32_t index = 0);
+    uint32_t Allocate();
+
+    /*
+     * Frees a claimed index, advancing its generation so it can be reused.
+     */
+    void Free(const uint32_t index);
+
+    /*
+     * Acquires the page holding the given index, and returns its entry.
+     * Returns null if the page has been reclaimed, in which case the index is free.
+     * The entry and its generation can be examined until the page is released.
+     */
+    inline EntryType *Acquire(const uint32_t index);
+
+    /*
+     * Releases the page holding the given index, acquired by the calling thread.
+     */
+    inline void Release(const uint32_t index);
 
     /*
      * Gets a reference to the entry with the given index.
+     * The index must be claimed, or its page acquired.
      */
     inline EntryType &GetEntry(const uint32_t index);
 
+    /*
+     * Gets the current generation of the given index.
+     * The index must be claimed, or its page acquired.
+     */
+    inline uint32_t GetGeneration(const uint32_t index) const;
+
 private:
     static const uint32_t ENTRIES_PER_PAGE = 1024;  // Number of entries in each allocated page (power of two!).
     static const uint32_t MAX_PAGES = 1024;         // Maximum number of allocated pages.
+    static const uint32_t BITS_PER_WORD = 32;       // Number of pages tracked by each word of the free page mask.
+    static const uint32_t EXCLUSIVE = 0x80000000;   // Reference count flag held while a page is reclaimed.
+    static const uint32_t CREATING = 0x40000000;    // Reference count flag held while a page is created.
+
+    struct Slot {
+        inline Slot() : generation_(0), next_(0) {
+        }
+
+        std::atomic<uint32_t> generation_;          // Number of times the index has been freed.
+        std::atomic<uint32_t> next_;                // One more than the offset of the next free index in the page.
+    };
 
     struct Page {
         EntryType entries_[ENTRIES_PER_PAGE];       // Array of entries making up this page.
+        Slot slots_[ENTRIES_PER_PAGE];              // Allocation state of each entry.
+    };
+
+    // Bookkeeping for each page, which outlives the page itself.
+    struct PageState {
+        std::atomic<Page *> page_;                  // Pointer to the allocated page, if any.
+        std::atomic<uint32_t> references_;          // Claimed indices and acquired references, and the flags.
+        std::atomic<uint32_t> generation_;          // Generation at which the next allocation of the page starts.
+        std::atomic<uint64_t> free_head_;           // One more than the offset of the first free index, tagged against reuse.
     };
 
     Directory(const Directory &other);
     Directory &operator=(const Directory &other);
 
-    mutable Mutex mutex_;                           // Ensures thread-safe access to the instance data.
-    uint32_t next_index_;                           // Auto-incremented index to use for next registered entity.
-    Page *pages_[MAX_PAGES];                        // Pointers to allocated pages.
+    inline Slot &GetSlot(const uint32_t index) const;
+
+    // Claims a free index from the given page, returning zero if it has none.
+    inline uint32_t Claim(const uint32_t page);
+
+    // Allocates the given page if it isn't already allocated, and claims its first index.
+    // Returns zero if the page couldn't be allocated by this thread.
+    uint32_t Create(const uint32_t page);
+
+    // Frees the given page if nothing references it.
+    void Reclaim(const uint32_t page);
+
+    // Drops a reference to the given page, reclaiming it if that was the last.
+    inline void Unreference(const uint32_t page);
+
+    inline void MarkFree(const uint32_t page);
+    inline void MarkFull(const uint32_t page);
+
+    // Builds a free list head from a previous head and a new first entry.
+    // The tag in the upper half is bumped by every change to the head, so a pop can't
+    // succeed against a head that was popped and pushed again in the meantime.
+    inline static uint64_t MakeHead(const uint64_t head, const uint32_t link);
+
+    PageState pages_[MAX_PAGES];                    // State of each page, allocated or not.
+    std::atomic<uint32_t> free_pages_[MAX_PAGES / BITS_PER_WORD];   // Mask of pages that may have free indices.
 };
 
 
 template <class EntryType>
-inline Directory<EntryType>::Directory() 
-  : mutex_(),
-    next_index_(0) {
+inline Directory<EntryType>::Directory() {
     // Clear the page table.
     for (uint32_t page = 0; page < MAX_PAGES; ++page) {
-        pages_[page] = 0;
+        pages_[page].page_.store(0, std::memory_order_relaxed);
+        pages_[page].references_.store(0, std::memory_order_relaxed);
+        pages_[page].generation_.store(0, std::memory_order_relaxed);
+        pages_[page].free_head_.store(0, std::memory_order_relaxed);
+    }
+
+    for (uint32_t word = 0; word < MAX_PAGES / BITS_PER_WORD; ++word) {
+        free_pages_[word].store(0, std::memory_order_relaxed);
     }
 }
 
@@ -69,61 +159,335 @@ template <class EntryType>
 inline Directory<EntryType>::~Directory() {
     AllocatorInterface *const page_allocator(AllocatorManager::GetCache());
 
-    // Free all pages that were allocated.
+    // Free all pages that are still allocated.
     for (uint32_t page = 0; page < MAX_PAGES; ++page) {
-        if (pages_[page]) {
+        if (Page *const page_pointer = pages_[page].page_.load(std::memory_order_relaxed)) {
             // Destruct and free.
-            pages_[page]->~Page();
-            page_allocator->FreeWithSize(pages_[page], sizeof(Page));            
+            page_pointer->~Page();
+            page_allocator->FreeWithSize(page_pointer, sizeof(Page));
         }
     }
 }
 
 template <class EntryType>
-inline uint32_t Directory<EntryType>::Allocate(uint32_t index) {
-    mutex_.Lock();
+inline uint32_t Directory<EntryType>::Allocate() {
+    while (true) {
+        // Claim an index from the lowest page that has one free.
+        for (uint32_t word = 0; word < MAX_PAGES / BITS_PER_WORD; ++word) {
+            uint32_t mask(free_pages_[word].load(std::memory_order_acquire));
+            while (mask) {
+                const uint32_t page(word * BITS_PER_WORD + static_cast<uint32_t>(__builtin_ctz(mask)));
+                if (const uint32_t index = Claim(page)) {
+                    return index;
+                }
+
+                mask &= mask - 1;
+            }
+        }
+
+        // Otherwise allocate the lowest unallocated page, or try again if another thread beats us to it.
+        uint32_t page(0);
+        while (page < MAX_PAGES && pages_[page].page_.load(std::memory_order_acquire)) {
+            ++page;
+        }
 
-    // Auto-allocate an index if none was specified.
-    if (index == 0) {
-        // TODO: Avoid in-use indices and re-use freed ones.
-        // Skip index zero as it's reserved for use as the null address.
-        if (++next_index_ == MAX_PAGES * ENTRIES_PER_PAGE) {
-            next_index_ = 1;
+        if (page == MAX_PAGES) {
+            AF_FAIL_MSG("Directory is full");
+            return 0;
         }
 
-        index = next_index_;
+        if (const uint32_t index = Create(page)) {
+            return index;
+        }
     }
+}
+
+template <class EntryType>
+inline void Directory<EntryType>::Free(const uint32_t index) {
+    AF_ASSERT(index);
 
-    // Allocate the page if it hasn't been allocated already.
     const uint32_t page(index / ENTRIES_PER_PAGE);
-    if (pages_[page] == 0) {
-        AllocatorInterface *const page_allocator(AllocatorManager::GetCache());
-        void *const page_memory(page_allocator->AllocateAligned(sizeof(Page), AF_CACHELINE_ALIGNMENT));
+    const uint32_t offset(index % ENTRIES_PER_PAGE);
+    PageState &state(pages_[page]);
+
+    // Advance the generation before the index can be reused, so that addresses
+    // issued for it are already stale by the time it's claimed again.
+    Slot &slot(GetSlot(index));
+    slot.generation_.fetch_add(1, std::memory_order_release);
+
+    uint64_t head(state.free_head_.load(std::memory_order_relaxed));
+    do {
+        slot.next_.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    } while (!state.free_head_.compare_exchange_weak(
+        head,
+        MakeHead(head, offset + 1),
+        std::memory_order_release,
+        std::memory_order_relaxed));
+
+    // Advertise the free index, then drop the reference held by the claim.
+    MarkFree(page);
+    Unreference(page);
+}
 
-        if (page_memory) {
-            pages_[page] = new (page_memory) Page();
-        } else {
-            AF_FAIL_MSG("Out of memory");
+template <class EntryType>
+AF_FORCEINLINE EntryType *Directory<EntryType>::Acquire(const uint32_t index) {
+    const uint32_t page(index / ENTRIES_PER_PAGE);
+    const uint32_t offset(index % ENTRIES_PER_PAGE);
+
+    if (page >= MAX_PAGES) {
+        return 0;
+    }
+
+    // A page being reclaimed can't be examined, and one being created isn't yet published.
+    // Pages are published in a hazard slot before checking whether they're being reclaimed,
+    // and the reclaiming thread checks the slots after taking the page, so one sees the other.
+    // Threads examining more pages at once than they have slots count a reference instead.
+    PageState &state(pages_[page]);
+    if (page != 0) {
+        if (PageHazards::Protect(&state)) {
+            if (state.references_.load(std::memory_order_seq_cst) & EXCLUSIVE) {
+                PageHazards::Unprotect(&state);
+                return 0;
+            }
+        } else if (state.references_.fetch_add(1, std::memory_order_acquire) & EXCLUSIVE) {
+            Unreference(page);
+            return 0;
         }
     }
 
-    mutex_.Unlock();
+    Page *const page_pointer(state.page_.load(std::memory_order_acquire));
+    if (page_pointer == 0) {
+        Release(index);
+        return 0;
+    }
 
-    return index;
+    return page_pointer->entries_ + offset;
+}
+
+template <class EntryType>
+AF_FORCEINLINE void Directory<EntryType>::Release(const uint32_t index) {
+    const uint32_t page(index / ENTRIES_PER_PAGE);
+    if (page == 0) {
+        return;
+    }
+
+    PageState &state(pages_[page]);
+    if (!PageHazards::Unprotect(&state)) {
+        Unreference(page);
+        return;
+    }
+
+    // A thread trying to reclaim the page backs off if it's published,
+    // so the last thread to withdraw it from an empty page reclaims it instead.
+    if (state.references_.load(std::memory_order_seq_cst) == 0) {
+        Reclaim(page);
+    }
 }
 
 template <class EntryType>
 AF_FORCEINLINE EntryType &Directory<EntryType>::GetEntry(const uint32_t index) {
     // Compute the page and offset.
-    // TODO: Use a mask?
     const uint32_t page(index / ENTRIES_PER_PAGE);
     const uint32_t offset(index % ENTRIES_PER_PAGE);
 
     AF_ASSERT(page < MAX_PAGES);
     AF_ASSERT(offset < ENTRIES_PER_PAGE);
-    AF_ASSERT(pages_[page]);
 
-    return pages_[page]->entries_[offset];
+    Page *const page_pointer(pages_[page].page_.load(std::memory_order_acquire));
+    AF_ASSERT(page_pointer);
+
+    return page_pointer->entries_[offset];
+}
+
+template <class EntryType>
+AF_FORCEINLINE uint32_t Directory<EntryType>::GetGeneration(const uint32_t index) const {
+    return GetSlot(index).generation_.load(std::memory_order_acquire);
+}
+
+template <class EntryType>
+AF_FORCEINLINE typename Directory<EntryType>::Slot &Directory<EntryType>::GetSlot(const uint32_t index) const {
+    const uint32_t page(index / ENTRIES_PER_PAGE);
+    const uint32_t offset(index % ENTRIES_PER_PAGE);
+
+    AF_ASSERT(page < MAX_PAGES);
+
+    Page *const page_pointer(pages_[page].page_.load(std::memory_order_acquire));
+    AF_ASSERT(page_pointer);
+
+    return page_pointer->slots_[offset];
+}
+
+template <class EntryType>
+AF_FORCEINLINE uint32_t Directory<EntryType>::Claim(const uint32_t page) {
+    PageState &state(pages_[page]);
+
+    // Reference the page, so it can't be reclaimed while we read its free list.
+    // If we claim an index the reference is kept, and dropped when the index is freed.
+    if (state.references_.fetch_add(1, std::memory_order_acquire) & EXCLUSIVE) {
+        Unreference(page);
+        return 0;
+    }
+
+    Page *const page_pointer(state.page_.load(std::memory_order_acquire));
+    if (page_pointer == 0) {
+        Unreference(page);
+        return 0;
+    }
+
+    while (true) {
+        uint64_t head(state.free_head_.load(std::memory_order_acquire));
+        while (const uint32_t link = static_cast<uint32_t>(head)) {
+            // Free entries are only linked within a referenced page, so the link is safe
+            // to read even if the entry is claimed by another thread first, in which case
+            // the swap fails.
+            const uint32_t next(page_pointer->slots_[link - 1].next_.load(std::memory_order_relaxed));
+            if (state.free_head_.compare_exchange_weak(
+                head,
+                MakeHead(head, next),
+                std::memory_order_acquire,
+                std::memory_order_acquire)) {
+                return page * ENTRIES_PER_PAGE + link - 1;
+            }
+        }
+
+        // The page is full. Withdraw its advertisement, unless an index was freed meanwhile,
+        // in which case the thread that freed it may have seen it still advertised.
+        MarkFull(page);
+        if (static_cast<uint32_t>(state.free_head_.load(std::memory_order_seq_cst)) == 0) {
+            break;
+        }
+
+        MarkFree(page);
+    }
+
+    Unreference(page);
+    return 0;
+}
+
+template <class EntryType>
+inline uint32_t Directory<EntryType>::Create(const uint32_t page) {
+    PageState &state(pages_[page]);
+
+    // Flag the page as being created, failing if it's being created or reclaimed by another thread.
+    // Threads examining stale addresses may have acquired the unallocated page, but they
+    // back off without touching it once they see it's unallocated. The flag doesn't stop threads
+    // using the page if another thread turns out to have allocated it already.
+    uint32_t references(state.references_.load(std::memory_order_relaxed));
+    do {
+        if (references & (EXCLUSIVE | CREATING)) {
+            return 0;
+        }
+    } while (!state.references_.compare_exchange_weak(references, references | CREATING, std::memory_order_acquire));
+
+    uint32_t index(0);
+    if (state.page_.load(std::memory_order_relaxed) == 0) {
+        AllocatorInterface *const page_allocator(AllocatorManager::GetCache());
+        void *const page_memory(page_allocator->AllocateAligned(sizeof(Page), AF_CACHELINE_ALIGNMENT));
+
+        if (page_memory == 0) {
+            AF_FAIL_MSG("Out of memory");
+        } else {
+            Page *const new_page(new (page_memory) Page());
+
+            // Continue the generations of the previous allocation of the page, and link all its
+            // entries into its free list in order, but for the first, which we claim.
+            // Index zero is reserved for use as the null address.
+            const uint32_t generation(state.generation_.load(std::memory_order_relaxed));
+            const uint32_t first(page == 0 ? 1 : 0);
+
+            for (uint32_t offset = 0; offset < ENTRIES_PER_PAGE; ++offset) {
+                new_page->slots_[offset].generation_.store(generation, std::memory_order_relaxed);
+                new_page->slots_[offset].next_.store(
+                    offset + 1 < ENTRIES_PER_PAGE ? offset + 2 : 0,
+                    std::memory_order_relaxed);
+            }
+
+            const uint64_t head(state.free_head_.load(std::memory_order_relaxed));
+            state.free_head_.store(MakeHead(head, first + 2), std::memory_order_relaxed);
+            state.page_.store(new_page, std::memory_order_release);
+            MarkFree(page);
+
+            index = page * ENTRIES_PER_PAGE + first;
+        }
+    }
+
+    // Our claim holds a reference, so the new page can't be reclaimed as soon as it's published.
+    // Otherwise, the last reference to an existing page may have been dropped while it was flagged.
+    if (index) {
+        state.references_.fetch_sub(CREATING - 1, std::memory_order_release);
+    } else if (state.references_.fetch_sub(CREATING, std::memory_order_acq_rel) == CREATING) {
+        Reclaim(page);
+    }
+
+    return index;
+}
+
+template <class EntryType>
+inline void Directory<EntryType>::Reclaim(const uint32_t page) {
+    // The first page is kept, so a directory holding few entities never churns pages.
+    if (page == 0) {
+        return;
+    }
+
+    PageState &state(pages_[page]);
+
+    // Take the page exclusively, failing if it's been referenced again or flagged meanwhile.
+    // Once it's ours no index can be claimed from it, and none can be freed into it.
+    uint32_t references(0);
+    if (!state.references_.compare_exchange_strong(references, EXCLUSIVE, std::memory_order_seq_cst)) {
+        return;
+    }
+
+    // Threads that published the page before we took it may still be examining it.
+    // They'll see it's empty when they withdraw it, and try again.
+    Page *page_pointer(state.page_.load(std::memory_order_relaxed));
+    if (page_pointer && PageHazards::IsProtected(&state)) {
+        page_pointer = 0;
+    }
+
+    if (page_pointer) {
+        // The next allocation of the page starts past every generation issued for it.
+        uint32_t generation(state.generation_.load(std::memory_order_relaxed));
+        for (uint32_t offset = 0; offset < ENTRIES_PER_PAGE; ++offset) {
+            const uint32_t slot_generation(page_pointer->slots_[offset].generation_.load(std::memory_order_relaxed));
+            if (static_cast<int32_t>(slot_generation - generation) > 0) {
+                generation = slot_generation;
+            }
+        }
+
+        MarkFull(page);
+        state.generation_.store(generation, std::memory_order_relaxed);
+        state.free_head_.store(MakeHead(state.free_head_.load(std::memory_order_relaxed), 0), std::memory_order_relaxed);
+        state.page_.store(0, std::memory_order_release);
+
+        AllocatorInterface *const page_allocator(AllocatorManager::GetCache());
+        page_pointer->~Page();
+        page_allocator->FreeWithSize(page_pointer, sizeof(Page));
+    }
+
+    state.references_.fetch_sub(EXCLUSIVE, std::memory_order_release);
+}
+
+template <class EntryType>
+AF_FORCEINLINE void Directory<EntryType>::Unreference(const uint32_t page) {
+    if (pages_[page].references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        Reclaim(page);
+    }
+}
+
+template <class EntryType>
+AF_FORCEINLINE void Directory<EntryType>::MarkFree(const uint32_t page) {
+    free_pages_[page / BITS_PER_WORD].fetch_or(1u << (page % BITS_PER_WORD), std::memory_order_seq_cst);
+}
+
+template <class EntryType>
+AF_FORCEINLINE void Directory<EntryType>::MarkFull(const uint32_t page) {
+    free_pages_[page / BITS_PER_WORD].fetch_and(~(1u << (page % BITS_PER_WORD)), std::memory_order_seq_cst);
+}
+
+template <class EntryType>
+AF_FORCEINLINE uint64_t Directory<EntryType>::MakeHead(const uint64_t head, const uint32_t link) {
+    return (((head >> 32) + 1) << 32) | static_cast<uint64_t>(link);
 }
 
 
@@ -132,4 +496,3 @@ AF_FORCEINLINE EntryType &Directory<EntryType>::GetEntry(const uint32_t index) {
 
 
 #endif // AF_DETAIL_DIRECTORY_DIRECTORY_H
-
@@ -0,0 +1,217 @@
+#include "AF/allocator_interface.h"
+#include "AF/allocator_manager.h"
+#include "AF/assert.h"
+#include "AF/defines.h"
+
+#include "AF/detail/directory/name_registry.h"
+
+#include "AF/detail/strings/string_hash.h"
+#include "AF/detail/strings/string_pool.h"
+
+#include "AF/detail/threading/lock.h"
+
+#include <new>
+#include <string.h>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+
+std::atomic<NameRegistry *> NameRegistry::instance_(0);
+Mutex NameRegistry::reference_mutex_;
+uint32_t NameRegistry::reference_count_ = 0;
+uint32_t NameRegistry::instance_count_ = 0;
+
+
+/*
+ * An entry in the per-thread cache of resolved names.
+ * Each entry holds its own copy of the name, so it can be compared without touching the registry.
+ */
+struct ResolutionCacheEntry {
+    uint64_t index_;                // Resolved index.
+    uint32_t hash_;                 // Hash of the name.
+    uint32_t version_;              // Version of the name's bucket when the name was resolved.
+    uint32_t serial_;               // Serial number of the registry instance that resolved the name.
+    char name_[48];                 // Copy of the name. Longer names aren't cached.
+};
+
+static const uint32_t RESOLUTION_CACHE_SIZE = 64;
+
+// Direct-mapped cache of names recently resolved by the calling thread.
+static thread_local ResolutionCacheEntry resolution_cache_[RESOLUTION_CACHE_SIZE];
+
+
+void NameRegistry::Reference() {
+    Lock lock(reference_mutex_);
+
+    // Create the singleton instance if this is the first reference.
+    if (reference_count_++ == 0) {
+        AllocatorInterface *const allocator(AllocatorManager::GetCache());
+        void *const memory(allocator->AllocateAligned(sizeof(NameRegistry), AF_CACHELINE_ALIGNMENT));
+        instance_.store(new (memory) NameRegistry(++instance_count_), std::memory_order_release);
+    }
+}
+
+void NameRegistry::Dereference() {
+    Lock lock(reference_mutex_);
+
+    // Destroy the singleton instance if this was the last reference.
+    if (--reference_count_ == 0) {
+        AllocatorInterface *const allocator(AllocatorManager::GetCache());
+        NameRegistry *const instance(instance_.exchange(0, std::memory_order_acq_rel));
+        instance->~NameRegistry();
+        allocator->FreeWithSize(instance, sizeof(NameRegistry));
+    }
+}
+
+NameRegistry::NameRegistry(const uint32_t serial) : serial_(serial) {
+}
+
+NameRegistry::~NameRegistry() {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    // Free any names still registered at end of day.
+    for (uint32_t index = 0; index < BUCKET_COUNT; ++index) {
+        List<Node> &nodes(buckets_[index].nodes_);
+        while (!nodes.Empty()) {
+            Node *const node(nodes.Front());
+            nodes.Remove(node);
+
+            StringPool::Release(node->name_);
+            node->~Node();
+            allocator->FreeWithSize(node, sizeof(Node));
+        }
+    }
+}
+
+void NameRegistry::Register(const String &name, const Index &index) {
+    NameRegistry *const instance(instance_.load(std::memory_order_acquire));
+
+    AF_ASSERT(instance);
+    AF_ASSERT(!name.IsNull());
+
+    const uint32_t hash(StringHash::ComputeFull(name.GetValue()));
+    Bucket &bucket(instance->GetBucket(hash));
+
+    // Allocate the node outside the lock, in case the name isn't registered yet.
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+    void *const memory(allocator->Allocate(sizeof(Node)));
+    AF_ASSERT_MSG(memory, "Failed to allocate name registry node");
+
+    Node *const created(new (memory) Node());
+    created->hash_ = hash;
+    created->name_ = name.GetValue();
+    created->index_ = index;
+
+    bucket.lock_.Lock();
+
+    Node *const existing(Find(bucket, name.GetValue(), hash));
+    if (existing) {
+        // Move the name to its new owner, invalidating cached resolutions to the old one.
+        existing->index_ = index;
+        bucket.version_.fetch_add(1, std::memory_order_release);
+    } else {
+        StringPool::Acquire(created->name_);
+        bucket.nodes_.Insert(created);
+    }
+
+    bucket.lock_.Unlock();
+
+    if (existing) {
+        created->~Node();
+        allocator->FreeWithSize(created, sizeof(Node));
+    }
+}
+
+void NameRegistry::Deregister(const String &name, const Index &index) {
+    NameRegistry *const instance(instance_.load(std::memory_order_acquire));
+
+    AF_ASSERT(instance);
+    AF_ASSERT(!name.IsNull());
+
+    const uint32_t hash(StringHash::ComputeFull(name.GetValue()));
+    Bucket &bucket(instance->GetBucket(hash));
+
+    bucket.lock_.Lock();
+
+    // The name may since have moved to another actor, in which case it's left alone.
+    Node *node(Find(bucket, name.GetValue(), hash));
+    if (node && node->index_ == index) {
+        bucket.nodes_.Remove(node);
+        bucket.version_.fetch_add(1, std::memory_order_release);
+    } else {
+        node = 0;
+    }
+
+    bucket.lock_.Unlock();
+
+    if (node) {
+        AllocatorInterface *const allocator(AllocatorManager::GetCache());
+        StringPool::Release(node->name_);
+        node->~Node();
+        allocator->FreeWithSize(node, sizeof(Node));
+    }
+}
+
+Index NameRegistry::Resolve(const char *const name) {
+    AF_ASSERT(name);
+
+    // No names are registered if the registry doesn't exist.
+    NameRegistry *const instance(instance_.load(std::memory_order_acquire));
+    if (instance == 0) {
+        return Index();
+    }
+
+    const uint32_t hash(StringHash::ComputeFull(name));
+    Bucket &bucket(instance->GetBucket(hash));
+
+    // Read the version before looking up the name, so a resolution made stale
+    // while it's being looked up is never cached as current.
+    const uint32_t version(bucket.version_.load(std::memory_order_acquire));
+
+    ResolutionCacheEntry &cached(resolution_cache_[hash & (RESOLUTION_CACHE_SIZE - 1)]);
+    if (cached.version_ == version &&
+        cached.serial_ == instance->serial_ &&
+        cached.hash_ == hash &&
+        cached.index_ != 0 &&
+        strcmp(cached.name_, name) == 0) {
+        Index index;
+        index.uint64_ = cached.index_;
+        return index;
+    }
+
+    bucket.lock_.Lock();
+    Node *const node(Find(bucket, name, hash));
+    const Index index(node ? node->index_ : Index());
+    bucket.lock_.Unlock();
+
+    // Cache resolved names short enough to be copied into the cache.
+    if (index.uint64_ != 0 && strlen(name) < sizeof(cached.name_)) {
+        cached.index_ = index.uint64_;
+        cached.hash_ = hash;
+        cached.version_ = version;
+        cached.serial_ = instance->serial_;
+        strcpy(cached.name_, name);
+    }
+
+    return index;
+}
+
+NameRegistry::Node *NameRegistry::Find(Bucket &bucket, const char *const name, const uint32_t hash) {
+    List<Node>::Iterator nodes(bucket.nodes_.GetIterator());
+    while (nodes.Next()) {
+        Node *const node(nodes.Get());
+        if (node->hash_ == hash && strcmp(node->name_, name) == 0) {
+            return node;
+        }
+    }
+
+    return 0;
+}
+
+
+} // namespace Detail
+} // namespace AF
@@ -0,0 +1,126 @@
+#ifndef AF_DETAIL_DIRECTORY_NAMEREGISTRY_H
+#define AF_DETAIL_DIRECTORY_NAMEREGISTRY_H
+
+
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include "AF/detail/containers/list.h"
+
+#include "AF/detail/strings/string.h"
+
+#include "AF/detail/threading/mutex.h"
+#include "AF/detail/threading/spin_lock.h"
+
+#include "AF/detail/utils/utils.h"
+
+#include <atomic>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+
+/*
+ * Static class that maps the names of named actors to the indices of their mailboxes.
+ *
+ * Names are hashed to buckets, each with its own lock. Resolved names are cached per thread,
+ * along with the version of their bucket, which changes whenever a name in the bucket is
+ * withdrawn or moved to another actor. So repeatedly resolving the same name usually costs
+ * one cache lookup, and changing a name only invalidates cached names in the same bucket.
+ *
+ * The registry is created by its first reference and destroyed with its last. Cached names
+ * also record which instance of the registry resolved them, so they aren't trusted by its
+ * successor.
+ */
+class NameRegistry {
+public:
+    /*
+     * Holds a reference to the registry, ensuring that it has been created.
+     */
+    class Ref {
+    public:
+        inline Ref() {
+            NameRegistry::Reference();
+        }
+
+        inline ~Ref() {
+            NameRegistry::Dereference();
+        }
+    };
+
+    friend class Ref;
+
+    // Registers a name for the entity at the given index. A name registered again
+    // moves to the new index.
+    static void Register(const String &name, const Index &index);
+
+    // Withdraws a name, if it's still registered for the given index.
+    static void Deregister(const String &name, const Index &index);
+
+    // Gets the index registered for the given name, or a zero index if the name isn't registered.
+    // The caller must hold a reference to the registry, or otherwise ensure that it isn't
+    // destroyed meanwhile, as frameworks do by holding references until they're destroyed.
+    static Index Resolve(const char *const name);
+
+private:
+    /*
+     * A registered name and the index it resolves to.
+     */
+    class Node : public List<Node>::Node {
+    public:
+        uint32_t hash_;             // Cached hash of the name.
+        const char *name_;          // Pooled name, holding a reference to the pooled string.
+        Index index_;               // Index registered for the name.
+    };
+
+    /*
+     * A list of nodes protected by its own lock.
+     */
+    class AF_PREALIGN(AF_CACHELINE_ALIGNMENT) Bucket {
+    public:
+        inline Bucket() : version_(0) {
+        }
+
+        SpinLock lock_;
+        List<Node> nodes_;
+        std::atomic<uint32_t> version_;     // Changed whenever a cached resolution may have become stale.
+
+    } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
+
+    // References the registry, creating the singleton instance if it doesn't already exist.
+    static void Reference();
+
+    // Releases a reference to the registry, destroying the singleton instance if it is no longer referenced.
+    static void Dereference();
+
+    static std::atomic<NameRegistry *> instance_;   // Pointer to the singleton instance.
+    static Mutex reference_mutex_;                  // Synchronization object protecting reference counting.
+    static uint32_t reference_count_;               // Counts the number of references to the singleton.
+    static uint32_t instance_count_;                // Counts the number of instances ever created.
+
+    static const uint32_t BUCKET_COUNT = 256;
+
+    explicit NameRegistry(const uint32_t serial);
+    ~NameRegistry();
+
+    // Finds the node for a name in a locked bucket.
+    static Node *Find(Bucket &bucket, const char *const name, const uint32_t hash);
+
+    AF_FORCEINLINE Bucket &GetBucket(const uint32_t hash) {
+        return buckets_[hash & (BUCKET_COUNT - 1)];
+    }
+
+    Bucket buckets_[BUCKET_COUNT];
+    const uint32_t serial_;                         // Distinguishes this instance from earlier ones.
+};
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_DIRECTORY_NAMEREGISTRY_H
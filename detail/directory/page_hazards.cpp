@@ -0,0 +1,71 @@
+#include "AF/assert.h"
+#include "AF/defines.h"
+
+#include "AF/detail/directory/page_hazards.h"
+
+#include "AF/detail/threading/lock.h"
+
+
+namespace AF
+{
+namespace Detail
+{
+
+
+Mutex PageHazards::mutex_;
+PageHazards::Record *PageHazards::records_ = 0;
+
+
+PageHazards::Record::Record() :
+  previous_(0),
+  next_(0) {
+    for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+        slots_[slot].store(0, std::memory_order_relaxed);
+    }
+
+    Lock lock(mutex_);
+
+    next_ = records_;
+    if (records_) {
+        records_->previous_ = this;
+    }
+
+    records_ = this;
+}
+
+PageHazards::Record::~Record() {
+    Lock lock(mutex_);
+
+    // Threads can't exit while examining a page.
+    for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+        AF_ASSERT(slots_[slot].load(std::memory_order_relaxed) == 0);
+    }
+
+    if (previous_) {
+        previous_->next_ = next_;
+    } else {
+        records_ = next_;
+    }
+
+    if (next_) {
+        next_->previous_ = previous_;
+    }
+}
+
+bool PageHazards::IsProtected(const void *const page) {
+    Lock lock(mutex_);
+
+    for (const Record *record = records_; record; record = record->next_) {
+        for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+            if (record->slots_[slot].load(std::memory_order_seq_cst) == page) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+} // namespace Detail
+} // namespace AF
@@ -0,0 +1,114 @@
+#ifndef AF_DETAIL_DIRECTORY_PAGEHAZARDS_H
+#define AF_DETAIL_DIRECTORY_PAGEHAZARDS_H
+
+
+#include "AF/align.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include "AF/detail/threading/mutex.h"
+
+#include <atomic>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * Per-thread hazard slots, in which threads publish the directory pages they're examining.
+ *
+ * Each thread writes only to its own slots, held in a cache line of their own, so examining a
+ * page doesn't contend with other threads examining the same page. A thread reclaiming a page
+ * checks the slots of every thread, which is slow, but only happens once a page is empty.
+ */
+class PageHazards {
+public:
+    static const uint32_t SLOTS = 4;            // Number of pages each thread can publish at once.
+
+    /*
+     * Publishes the given page in a free slot of the calling thread.
+     * Returns false if the thread's slots are all in use, in which case nothing is published.
+     */
+    inline static bool Protect(const void *const page);
+
+    /*
+     * Withdraws a page published by the calling thread.
+     * Returns false if the thread hadn't published it.
+     */
+    inline static bool Unprotect(const void *const page);
+
+    /*
+     * Returns true if any thread has the given page published.
+     */
+    static bool IsProtected(const void *const page);
+
+private:
+    // The hazard slots of a thread, linked into a list of all the threads' slots.
+    class AF_PREALIGN(AF_CACHELINE_ALIGNMENT) Record {
+    public:
+        Record();
+        ~Record();
+
+        std::atomic<const void *> slots_[SLOTS];    // Pages published by the owning thread.
+        Record *previous_;                          // Previous record in the list, protected by the mutex.
+        Record *next_;                              // Next record in the list, protected by the mutex.
+
+    private:
+        Record(const Record &other);
+        Record &operator=(const Record &other);
+    } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
+
+    PageHazards();
+    PageHazards(const PageHazards &other);
+    PageHazards &operator=(const PageHazards &other);
+
+    // Returns the calling thread's record, which is linked into the list on first use.
+    inline static Record &GetRecord();
+
+    static Mutex mutex_;                        // Protects the list of records.
+    static Record *records_;                    // Head of the list of records of live threads.
+};
+
+
+AF_FORCEINLINE bool PageHazards::Protect(const void *const page) {
+    Record &record(GetRecord());
+
+    // Only the owning thread writes its slots. Publishing is fully ordered, so either the
+    // reclaiming thread sees the page published, or we see that the page has been taken.
+    for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+        if (record.slots_[slot].load(std::memory_order_relaxed) == 0) {
+            record.slots_[slot].store(page, std::memory_order_seq_cst);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+AF_FORCEINLINE bool PageHazards::Unprotect(const void *const page) {
+    Record &record(GetRecord());
+
+    for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+        if (record.slots_[slot].load(std::memory_order_relaxed) == page) {
+            record.slots_[slot].store(0, std::memory_order_seq_cst);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+AF_FORCEINLINE PageHazards::Record &PageHazards::GetRecord() {
+    static thread_local Record record;
+    return record;
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_DIRECTORY_PAGEHAZARDS_H
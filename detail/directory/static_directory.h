@@ -33,12 +33,22 @@ public:
     inline static uint32_t Register(Entry::Entity *const entity);
 
     /*
-     * Deregisters a previously registered entity.
+     * Deregisters a previously registered entity, freeing its index for reuse.
      */
     inline static void Deregister(const uint32_t index);
 
+    /*
+     * Acquires the entry at an index taken from a possibly stale address, returning null
+     * if it's been reclaimed. The acquired entry must be released once it's been examined.
+     */
+    inline static Entry *Acquire(const uint32_t index);
+
+    inline static void Release(const uint32_t index);
+
     inline static Entry &GetEntry(const uint32_t index);
 
+    inline static uint32_t GetGeneration(const uint32_t index);
+
 private:
     typedef Directory<Entry> DirectoryType;
 
@@ -114,6 +124,8 @@ inline void StaticDirectory<Entity>::Deregister(const uint32_t index) {
         entry.Unlock();
     }
 
+    directory_->Free(index);
+
     // Destroy the singleton instance if this was the last reference.
     if (--reference_count_ == 0) {
         AllocatorInterface *const allocator(AllocatorManager::GetCache());
@@ -124,6 +136,21 @@ inline void StaticDirectory<Entity>::Deregister(const uint32_t index) {
     mutex_.Unlock();
 }
 
+template <class Entity>
+AF_FORCEINLINE Entry *StaticDirectory<Entity>::Acquire(const uint32_t index) {
+    AF_ASSERT(directory_);
+    AF_ASSERT(index);
+
+    return directory_->Acquire(index);
+}
+
+template <class Entity>
+AF_FORCEINLINE void StaticDirectory<Entity>::Release(const uint32_t index) {
+    AF_ASSERT(directory_);
+
+    directory_->Release(index);
+}
+
 template <class Entity>
 AF_FORCEINLINE Entry &StaticDirectory<Entity>::GetEntry(const uint32_t index) {
     AF_ASSERT(directory_);
@@ -132,6 +159,14 @@ AF_FORCEINLINE Entry &StaticDirectory<Entity>::GetEntry(const uint32_t index) {
     return directory_->GetEntry(index);
 }
 
+template <class Entity>
+AF_FORCEINLINE uint32_t StaticDirectory<Entity>::GetGeneration(const uint32_t index) {
+    AF_ASSERT(directory_);
+    AF_ASSERT(index);
+
+    return directory_->GetGeneration(index);
+}
+
 
 } // namespace Detail
 } // namespace AF
@@ -10,7 +10,9 @@ namespace Detail
 HandlerCollection::HandlerCollection() 
   : handlers_(),
     new_handlers_(),
-    handlers_dirty_(false) {
+    handlers_dirty_(false),
+    table_(0),
+    table_mask_(0) {
 }
 
 HandlerCollection::~HandlerCollection() {
@@ -45,6 +47,72 @@ void HandlerCollection::UpdateHandlers() {
         new_handlers_.Remove(handler);
         handlers_.Insert(handler);
     }
+
+    BuildTable();
+}
+
+void HandlerCollection::BuildTable() {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    const uint32_t count(handlers_.Size());
+    if (count == 0) {
+        FreeTable();
+        return;
+    }
+
+    // Keep the table at most half full so probe sequences stay short.
+    uint32_t size(MIN_TABLE_SIZE);
+    while (size < count * 2) {
+        size <<= 1;
+    }
+
+    if (table_ == 0 || table_mask_ != size - 1) {
+        FreeTable();
+
+        table_ = static_cast<DispatchEntry *>(allocator->Allocate(size * sizeof(DispatchEntry)));
+        AF_ASSERT_MSG(table_, "Failed to allocate message handler dispatch table");
+
+        table_mask_ = size - 1;
+    }
+
+    for (uint32_t index = 0; index < size; ++index) {
+        table_[index].message_type_id_ = 0;
+        table_[index].handlers_ = 0;
+    }
+
+    // Chain the handlers of each message type in list order, which is the order they run in.
+    // Each chain is walked to its end to append, but chains are short and this is rare.
+    MessageHandlerList::Iterator handlers(handlers_.GetIterator());
+    while (handlers.Next()) {
+        MessageHandlerInterface *const handler(handlers.Get());
+        const TypeId message_type_id(handler->GetMessageTypeId());
+
+        uint32_t index(Hash(message_type_id) & table_mask_);
+        while (table_[index].message_type_id_ != 0 && table_[index].message_type_id_ != message_type_id) {
+            index = (index + 1) & table_mask_;
+        }
+
+        DispatchEntry &entry(table_[index]);
+        entry.message_type_id_ = message_type_id;
+        handler->next_match_ = 0;
+
+        MessageHandlerInterface **link(&entry.handlers_);
+        while (*link) {
+            link = &(*link)->next_match_;
+        }
+
+        *link = handler;
+    }
+}
+
+void HandlerCollection::FreeTable() {
+    if (table_) {
+        AllocatorInterface *const allocator(AllocatorManager::GetCache());
+        allocator->FreeWithSize(table_, (table_mask_ + 1) * sizeof(DispatchEntry));
+
+        table_ = 0;
+        table_mask_ = 0;
+    }
 }
 
 
@@ -3,10 +3,12 @@
 
 
 #include <new>
+#include <type_traits>
 
 #include "AF/address.h"
 #include "AF/allocator_interface.h"
 #include "AF/allocator_manager.h"
+#include "AF/assert.h"
 #include "AF/basic_types.h"
 #include "AF/defines.h"
 
@@ -15,12 +17,14 @@
 #include "AF/detail/handlers/message_handler.h"
 #include "AF/detail/handlers/message_handler_interface.h"
 #include "AF/detail/handlers/message_handler_cast.h"
+#include "AF/detail/handlers/move_message_handler.h"
 
 #include "AF/detail/messages/message_interface.h"
 #include "AF/detail/messages/message_traits.h"
 
 #include "AF/detail/scheduler/mailbox_context.h"
-#include "AF/detail/scheduler/scheduler_interface.h"
+
+#include "AF/detail/utils/type_id.h"
 
 
 namespace AF
@@ -31,6 +35,14 @@ class Actor;
 namespace Detail
 {
 
+/*
+ * The message handlers registered by an actor.
+ *
+ * Alongside the list of handlers the collection keeps a dispatch table, an open-addressed hash
+ * table keyed by message type, which maps each type to the chain of handlers that accept it.
+ * The table is rebuilt whenever the handlers change, so messages are only offered to the
+ * handlers that will actually handle them.
+ */
 class HandlerCollection {
 public:
     HandlerCollection();
@@ -46,31 +58,114 @@ public:
     template <class ActorType, class ValueType>
     inline bool Contains(void (ActorType::*handler)(const ValueType &message, const Address from)) const;
 
+    template <class ActorType, class ValueType>
+    inline bool Add(void (ActorType::*handler)(ValueType &&message, const Address from));
+
+    template <class ActorType, class ValueType>
+    inline bool Remove(void (ActorType::*handler)(ValueType &&message, const Address from));
+
+    template <class ActorType, class ValueType>
+    inline bool Contains(void (ActorType::*handler)(ValueType &&message, const Address from)) const;
+
     inline bool Clear();
 
     inline bool Handle(
         MailboxContext *const mailbox_context,
         Actor *const actor,
-        const MessageInterface *const message);
+        MessageInterface *const message);
 
 private:
     typedef List<MessageHandlerInterface> MessageHandlerList;
 
+    /*
+     * Entry in the dispatch table, heading the chain of handlers for one message type.
+     */
+    struct DispatchEntry {
+        TypeId message_type_id_;                // Message type, or null if the entry is unused.
+        MessageHandlerInterface *handlers_;     // First handler for the message type.
+    };
+
+    static const uint32_t MIN_TABLE_SIZE = 8;   // Smallest number of entries in the dispatch table.
+
     HandlerCollection(const HandlerCollection &other);
     HandlerCollection &operator=(const HandlerCollection &other);
 
+    template <class MessageHandlerType>
+    inline bool AddHandler(typename MessageHandlerType::HandlerFunction handler);
+
+    template <class MessageHandlerType>
+    inline bool RemoveHandler(typename MessageHandlerType::HandlerFunction handler);
+
+    template <class MessageHandlerType>
+    inline bool ContainsHandler(typename MessageHandlerType::HandlerFunction handler) const;
+
+    /*
+     * Returns true if any handler not marked for deregistration accepts the given message type.
+     */
+    inline bool HasHandlers(const TypeId message_type_id) const;
+
+    inline static uint32_t Hash(const TypeId type_id);
+
+    /*
+     * Returns the first handler in the dispatch table for the given message type, or null.
+     */
+    inline MessageHandlerInterface *Find(const TypeId message_type_id) const;
+
     void UpdateHandlers();
 
+    /*
+     * Rebuilds the dispatch table from the current handler list.
+     */
+    void BuildTable();
+
+    void FreeTable();
+
     MessageHandlerList handlers_;       // List of handlers in the collection.
     MessageHandlerList new_handlers_;   // List of handlers added since last update.
     bool handlers_dirty_;               ///< Flag indicating that the handlers are out of date.
+    DispatchEntry *table_;              // Dispatch table, with a power-of-two number of entries.
+    uint32_t table_mask_;               // Number of entries in the dispatch table, minus one.
 };
 
 
 template <class ActorType, class ValueType>
 AF_FORCEINLINE bool HandlerCollection::Add(void (ActorType::*handler)(const ValueType &message, const Address from)) {
-    typedef MessageHandler<ActorType, ValueType> MessageHandlerType;
+    return AddHandler<MessageHandler<ActorType, ValueType> >(handler);
+}
 
+template <class ActorType, class ValueType>
+AF_FORCEINLINE bool HandlerCollection::Remove(void (ActorType::*handler)(const ValueType &message, const Address from)) {
+    return RemoveHandler<MessageHandler<ActorType, ValueType> >(handler);
+}
+
+template <class ActorType, class ValueType>
+AF_FORCEINLINE bool HandlerCollection::Contains(void (ActorType::*handler)(const ValueType &message, const Address from)) const {
+    return ContainsHandler<MessageHandler<ActorType, ValueType> >(handler);
+}
+
+template <class ActorType, class ValueType>
+AF_FORCEINLINE bool HandlerCollection::Add(void (ActorType::*handler)(ValueType &&message, const Address from)) {
+    // Values that can't be copied can only be handed to one handler.
+    if (!std::is_copy_constructible<ValueType>::value && HasHandlers(TypeIdOf<ValueType>::Get())) {
+        AF_FAIL_MSG("A handler taking a move-only message value must be the only handler for its type");
+        return false;
+    }
+
+    return AddHandler<MoveMessageHandler<ActorType, ValueType> >(handler);
+}
+
+template <class ActorType, class ValueType>
+AF_FORCEINLINE bool HandlerCollection::Remove(void (ActorType::*handler)(ValueType &&message, const Address from)) {
+    return RemoveHandler<MoveMessageHandler<ActorType, ValueType> >(handler);
+}
+
+template <class ActorType, class ValueType>
+AF_FORCEINLINE bool HandlerCollection::Contains(void (ActorType::*handler)(ValueType &&message, const Address from)) const {
+    return ContainsHandler<MoveMessageHandler<ActorType, ValueType> >(handler);
+}
+
+template <class MessageHandlerType>
+AF_FORCEINLINE bool HandlerCollection::AddHandler(typename MessageHandlerType::HandlerFunction handler) {
     AllocatorInterface *const allocator(AllocatorManager::GetCache());
 
     // Allocate memory for a message handler object.
@@ -89,14 +184,10 @@ AF_FORCEINLINE bool HandlerCollection::Add(void (ActorType::*handler)(const Valu
     return true;
 }
 
-template <class ActorType, class ValueType>
-AF_FORCEINLINE bool HandlerCollection::Remove(void (ActorType::*handler)(const ValueType &message, const Address from)) {
-    // If the message value type has a valid (non-zero) type name defined for it,
-    // then we use explicit type names to match messages to handlers.
-    // The default value of zero indicates that no type name has been defined,
-    // in which case we rely on compiler-generated RTTI to identify message types.
-    typedef MessageHandler<ActorType, ValueType> MessageHandlerType;
-    typedef MessageHandlerCast<ActorType, MessageTraits<ValueType>::HAS_TYPE_NAME> HandlerCaster;
+template <class MessageHandlerType>
+AF_FORCEINLINE bool HandlerCollection::RemoveHandler(typename MessageHandlerType::HandlerFunction handler) {
+    // Handlers are matched by comparing their type identifiers, which needs neither RTTI
+    // nor registration of the message type.
 
     // We don't need to lock this because only one thread can access it at a time.
     // Find the handler in the registered handler list.
@@ -105,7 +196,7 @@ AF_FORCEINLINE bool HandlerCollection::Remove(void (ActorType::*handler)(const V
         MessageHandlerInterface *const message_handler(handlers.Get());
 
         // Try to convert this handler, of unknown type, to the target type.
-        if (const MessageHandlerType *const typed_handler = HandlerCaster:: template CastHandler<ValueType>(message_handler)) {
+        if (const MessageHandlerType *const typed_handler = MessageHandlerCast::CastHandler<MessageHandlerType>(message_handler)) {
             // Don't count the handler if it's already marked for deregistration.
             if (typed_handler->GetHandlerFunction() == handler && !typed_handler->IsMarked()) {
                 // Mark the handler for deregistration.
@@ -128,7 +219,7 @@ AF_FORCEINLINE bool HandlerCollection::Remove(void (ActorType::*handler)(const V
         MessageHandlerInterface *const message_handler(handlers.Get());
 
         // Try to convert this handler, of unknown type, to the target type.
-        if (const MessageHandlerType *const typed_handler = HandlerCaster:: template CastHandler<ValueType>(message_handler)) {
+        if (const MessageHandlerType *const typed_handler = MessageHandlerCast::CastHandler<MessageHandlerType>(message_handler)) {
             // Don't count the handler if it's already marked for deregistration.
             if (typed_handler->GetHandlerFunction() == handler && !typed_handler->IsMarked()) {
                 // Mark the handler for deregistration.
@@ -143,18 +234,15 @@ AF_FORCEINLINE bool HandlerCollection::Remove(void (ActorType::*handler)(const V
     return false;
 }
 
-template <class ActorType, class ValueType>
-AF_FORCEINLINE bool HandlerCollection::Contains(void (ActorType::*handler)(const ValueType &message, const Address from)) const {
-    typedef MessageHandler<ActorType, ValueType> MessageHandlerType;
-    typedef MessageHandlerCast<ActorType, MessageTraits<ValueType>::HAS_TYPE_NAME> HandlerCaster;
-
+template <class MessageHandlerType>
+AF_FORCEINLINE bool HandlerCollection::ContainsHandler(typename MessageHandlerType::HandlerFunction handler) const {
     // Search for the handler in the registered handler list.
     typename MessageHandlerList::Iterator handlers(handlers_.GetIterator());
     while (handlers.Next()) {
         MessageHandlerInterface *const message_handler(handlers.Get());
 
         // Try to convert this handler, of unknown type, to the target type.
-        if (const MessageHandlerType *const typed_handler = HandlerCaster:: template CastHandler<ValueType>(message_handler)) {
+        if (const MessageHandlerType *const typed_handler = MessageHandlerCast::CastHandler<MessageHandlerType>(message_handler)) {
             // Count as not registered if it's marked for deregistration.
             // But it may be registered more than once, so keep looking.
             if (typed_handler->GetHandlerFunction() == handler && !typed_handler->IsMarked()) {
@@ -169,7 +257,7 @@ AF_FORCEINLINE bool HandlerCollection::Contains(void (ActorType::*handler)(const
         MessageHandlerInterface *const message_handler(handlers.Get());
 
         // Try to convert this handler, of unknown type, to the target type.
-        if (const MessageHandlerType *const typed_handler = HandlerCaster:: template CastHandler<ValueType>(message_handler)) {
+        if (const MessageHandlerType *const typed_handler = MessageHandlerCast::CastHandler<MessageHandlerType>(message_handler)) {
             // Count as not registered if it's marked for deregistration.
             // But it may be registered more than once, so keep looking.
             if (typed_handler->GetHandlerFunction() == handler && !typed_handler->IsMarked()) {
@@ -181,6 +269,26 @@ AF_FORCEINLINE bool HandlerCollection::Contains(void (ActorType::*handler)(const
     return false;
 }
 
+AF_FORCEINLINE bool HandlerCollection::HasHandlers(const TypeId message_type_id) const {
+    MessageHandlerList::Iterator handlers(handlers_.GetIterator());
+    while (handlers.Next()) {
+        const MessageHandlerInterface *const message_handler(handlers.Get());
+        if (message_handler->GetMessageTypeId() == message_type_id && !message_handler->IsMarked()) {
+            return true;
+        }
+    }
+
+    handlers = new_handlers_.GetIterator();
+    while (handlers.Next()) {
+        const MessageHandlerInterface *const message_handler(handlers.Get());
+        if (message_handler->GetMessageTypeId() == message_type_id && !message_handler->IsMarked()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 AF_FORCEINLINE bool HandlerCollection::Clear() {
     AllocatorInterface *const allocator(AllocatorManager::GetCache());
 
@@ -198,17 +306,18 @@ AF_FORCEINLINE bool HandlerCollection::Clear() {
     }
 
     handlers_dirty_ = false;
+    FreeTable();
+
     return true;
 }
 
 AF_FORCEINLINE bool HandlerCollection::Handle(
     MailboxContext *const mailbox_context,
     Actor *const actor,
-    const MessageInterface *const message) {
+    MessageInterface *const message) {
     bool handled(false);
-    SchedulerInterface *const scheduler(mailbox_context->scheduler_);
 
-    AF_ASSERT(scheduler);
+    AF_ASSERT(mailbox_context);
     AF_ASSERT(actor);
     AF_ASSERT(message);
 
@@ -217,20 +326,52 @@ AF_FORCEINLINE bool HandlerCollection::Handle(
         UpdateHandlers();
     }
 
-    // Give each registered handler a chance to handle this message.
-    MessageHandlerList::Iterator handlers(handlers_.GetIterator());
-    while (handlers.Next()) {
-        MessageHandlerInterface *const message_handler(handlers.Get());
+    // Find the chain of handlers registered for the message type, if any.
+    MessageHandlerInterface *message_handler(Find(message->GetTypeId()));
+    if (message_handler == 0) {
+        // Sends made by the fallback handlers aren't predicted.
+        mailbox_context->ClearHandler();
+        return false;
+    }
 
-        // We notify the scheduler, which acts as an observer.
-        scheduler->BeginHandler(mailbox_context, message_handler);
+    // Give each handler for this message type a chance to handle it.
+    // Handlers deregistered meanwhile stay in the chain until the next update, as in the list.
+    // Only these handlers accept the message, so only their send counts are tracked.
+    while (message_handler) {
+        mailbox_context->BeginHandler(message_handler);
         handled |= message_handler->Handle(actor, message);
-        scheduler->EndHandler(mailbox_context, message_handler);
+        mailbox_context->EndHandler(message_handler);
+
+        message_handler = message_handler->next_match_;
     }
 
     return handled;
 }
 
+AF_FORCEINLINE MessageHandlerInterface *HandlerCollection::Find(const TypeId message_type_id) const {
+    if (table_ == 0) {
+        return 0;
+    }
+
+    uint32_t index(Hash(message_type_id) & table_mask_);
+    while (table_[index].message_type_id_ != message_type_id) {
+        if (table_[index].message_type_id_ == 0) {
+            return 0;
+        }
+
+        index = (index + 1) & table_mask_;
+    }
+
+    return table_[index].handlers_;
+}
+
+AF_FORCEINLINE uint32_t HandlerCollection::Hash(const TypeId type_id) {
+    // Type identifiers are addresses of adjacent static markers, so mix the bits with a
+    // multiplicative hash and take the high half.
+    const uint64_t value(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(type_id)));
+    return static_cast<uint32_t>((value * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
 
 } // namespace Detail
 } // namespace AF
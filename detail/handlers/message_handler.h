@@ -35,7 +35,9 @@ class MessageHandler : public MessageHandlerInterface {
 public:
     typedef void (ActorType::*HandlerFunction)(const ValueType &message, const Address from);
 
-    inline explicit MessageHandler(HandlerFunction function) : handler_function_(function) {
+    inline explicit MessageHandler(HandlerFunction function)
+      : MessageHandlerInterface(TypeIdOf<MessageHandler>::Get(), TypeIdOf<ValueType>::Get()),
+        handler_function_(function) {
     }
 
     inline virtual ~MessageHandler() {
@@ -45,25 +47,19 @@ public:
         return handler_function_;
     }
 
-    inline virtual const char *GetMessageTypeName() const {
-        return MessageTraits<ValueType>::TYPE_NAME;
-    }
-
     /*
      * Handles the given message, if it's of the type accepted by the handler.
      * return True, if the handler handled the message.
      * The message is not consumed by the handler; just acted on or ignored.
      * The message will be automatically destroyed when all handlers have seen it.
      */
-    inline virtual bool Handle(Actor *const actor, const MessageInterface *const message) {
-        typedef MessageCast<MessageTraits<ValueType>::HAS_TYPE_NAME> MessageCaster;
-    
+    inline virtual bool Handle(Actor *const actor, MessageInterface *const message) {
         AF_ASSERT(actor);
         AF_ASSERT(handler_function_);
         AF_ASSERT(message);
 
         // Try to convert the message, of unknown type, to message of the assumed type.
-        const Message<ValueType> *const typed_message = MessageCaster:: template CastMessage<ValueType>(message);
+        const Message<ValueType> *const typed_message = MessageCast::CastMessage<ValueType>(message);
         if (typed_message) {
             // Call the handler, passing it the message value and from address.
             ActorType *const typed_actor = static_cast<ActorType *>(actor);
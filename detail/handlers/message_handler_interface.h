@@ -9,6 +9,8 @@
 
 #include "AF/detail/messages/message_interface.h"
 
+#include "AF/detail/utils/type_id.h"
+
 
 namespace AF
 {
@@ -20,7 +22,12 @@ namespace Detail
 
 class MessageHandlerInterface : public List<MessageHandlerInterface>::Node {
 public:
-    AF_FORCEINLINE MessageHandlerInterface() : marked_(false), predict_send_count_(0) {
+    AF_FORCEINLINE MessageHandlerInterface(const TypeId handler_type_id, const TypeId message_type_id)
+      : next_match_(0),
+        handler_type_id_(handler_type_id),
+        message_type_id_(message_type_id),
+        marked_(false),
+        predict_send_count_(0) {
     }
 
     inline virtual ~MessageHandlerInterface() {
@@ -37,20 +44,37 @@ public:
     // Gets a prediction of the number of messages that would be sent by the handler when invoked.
     inline uint32_t GetPredictedSendCount() const;
 
-    // Returns the unique name of the message type handled by this handler.
-    virtual const char *GetMessageTypeName() const = 0;
+    // Returns the identifier of the concrete type of this handler.
+    inline TypeId GetHandlerTypeId() const;
+
+    // Returns the identifier of the message type accepted by this handler.
+    inline TypeId GetMessageTypeId() const;
 
-    virtual bool Handle(Actor *const actor, const MessageInterface *const message) = 0;
+    virtual bool Handle(Actor *const actor, MessageInterface *const message) = 0;
+
+    // Next handler for the same message type, in dispatch order. This is null for the last
+    // handler offered a message, which may therefore take ownership of the message value.
+    MessageHandlerInterface *next_match_;
 
 private:
     MessageHandlerInterface(const MessageHandlerInterface &other);
     MessageHandlerInterface &operator=(const MessageHandlerInterface &other);
 
+    const TypeId handler_type_id_;  // Identifier of the concrete handler type.
+    const TypeId message_type_id_;  // Identifier of the message type accepted by the handler.
     bool marked_;                   // Flag used to mark the handler for deletion.
     uint32_t predict_send_count_;   // Number of messages that are predicted to be sent by the handler.
 };
 
 
+AF_FORCEINLINE TypeId MessageHandlerInterface::GetHandlerTypeId() const {
+    return handler_type_id_;
+}
+
+AF_FORCEINLINE TypeId MessageHandlerInterface::GetMessageTypeId() const {
+    return message_type_id_;
+}
+
 AF_FORCEINLINE void MessageHandlerInterface::Mark() {
     marked_ = true;
 }
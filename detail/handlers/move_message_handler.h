@@ -0,0 +1,117 @@
+#ifndef AF_DETAIL_HANDLERS_MOVEMESSAGEHANDLER_H
+#define AF_DETAIL_HANDLERS_MOVEMESSAGEHANDLER_H
+
+#include "AF/address.h"
+#include "AF/assert.h"
+#include "AF/defines.h"
+
+#include "AF/detail/handlers/message_handler_interface.h"
+
+#include "AF/detail/messages/message.h"
+#include "AF/detail/messages/message_cast.h"
+#include "AF/detail/messages/message_interface.h"
+
+#include "AF/detail/utils/type_id.h"
+
+#include <type_traits>
+#include <utility>
+
+
+namespace AF
+{
+
+class Actor;
+
+namespace Detail
+{
+
+/*
+ * Message handler for handler functions that take ownership of the message value.
+ *
+ * The handler function receives the value by rvalue reference, so it can move the value on,
+ * for example into a message sent to the next actor in a pipeline, without copying it.
+ * The value carried by the message is handed over only when this is the last handler offered
+ * the message; any handler for the same message type that runs after it receives its own copy
+ * instead, so the other handlers still see the original value. The moved-from value is left
+ * in the message and destroyed with it as usual. Values that can't be copied can only be handed
+ * to one handler, so a handler taking such a value must be the only handler for its type.
+ * 
+ * ActorType: The type of actor whose message handlers are considered.
+ * ValueType: The type of message handled by this message handler.
+ */
+template <class ActorType, class ValueType>
+class MoveMessageHandler : public MessageHandlerInterface {
+public:
+    typedef void (ActorType::*HandlerFunction)(ValueType &&message, const Address from);
+
+    inline explicit MoveMessageHandler(HandlerFunction function)
+      : MessageHandlerInterface(TypeIdOf<MoveMessageHandler>::Get(), TypeIdOf<ValueType>::Get()),
+        handler_function_(function) {
+    }
+
+    inline virtual ~MoveMessageHandler() {
+    }
+
+    AF_FORCEINLINE HandlerFunction GetHandlerFunction() const {
+        return handler_function_;
+    }
+
+    /*
+     * Handles the given message, if it's of the type accepted by the handler.
+     * return True, if the handler handled the message.
+     */
+    inline virtual bool Handle(Actor *const actor, MessageInterface *const message) {
+        AF_ASSERT(actor);
+        AF_ASSERT(handler_function_);
+        AF_ASSERT(message);
+
+        // Try to convert the message, of unknown type, to message of the assumed type.
+        Message<ValueType> *const typed_message = MessageCast::CastMessage<ValueType>(message);
+        if (typed_message) {
+            ActorType *const typed_actor = static_cast<ActorType *>(actor);
+
+            // Only the last handler in the dispatch chain can take the value itself,
+            // and only if the value isn't shared with other messages.
+            if (next_match_ == 0 && !typed_message->IsShared()) {
+                (typed_actor->*handler_function_)(std::move(typed_message->Value()), typed_message->From());
+            } else {
+                HandleCopy(typed_actor, typed_message, std::is_copy_constructible<ValueType>());
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    MoveMessageHandler(const MoveMessageHandler &other);
+    MoveMessageHandler &operator=(const MoveMessageHandler &other);
+
+    // Calls the handler function with its own copy of the message value.
+    AF_FORCEINLINE void HandleCopy(
+        ActorType *const actor,
+        const Message<ValueType> *const message,
+        std::true_type /*copyable*/) {
+        ValueType value(message->Value());
+        (actor->*handler_function_)(std::move(value), message->From());
+    }
+
+    // Values that can't be copied are only ever taken by the one handler for their type,
+    // which is the last handler offered them, so this is only reached by misuse.
+    AF_FORCEINLINE void HandleCopy(
+        ActorType *const /*actor*/,
+        const Message<ValueType> *const /*message*/,
+        std::false_type /*copyable*/) {
+        AF_FAIL_MSG("Move-only message values can't be handed to more than one handler");
+    }
+
+    const HandlerFunction handler_function_;     // Pointer to a handler member function on an actor.
+};
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_HANDLERS_MOVEMESSAGEHANDLER_H
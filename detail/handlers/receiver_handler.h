@@ -25,7 +25,8 @@ public:
     typedef void (ObjectType::*HandlerFunction)(const ValueType &message, const Address from);
 
     inline ReceiverHandler(ObjectType *const object, HandlerFunction function) 
-      : object_(object),
+      : ReceiverHandlerInterface(TypeIdOf<ReceiverHandler>::Get()),
+        object_(object),
         handler_function_(function) {
     }
 
@@ -36,19 +37,13 @@ public:
         return handler_function_;
     }
 
-    inline virtual const char *GetMessageTypeName() const {
-        return MessageTraits<ValueType>::TYPE_NAME;
-    }
-
     inline virtual bool Handle(const MessageInterface *const message) const {
-        typedef MessageCast<MessageTraits<ValueType>::HAS_TYPE_NAME> MessageCaster;
-    
         AF_ASSERT(object_);
         AF_ASSERT(handler_function_);
         AF_ASSERT(message);
 
         // Try to convert the message, of unknown type, to message of the assumed type.
-        const Message<ValueType> *const typed_message = MessageCaster:: template CastMessage<ValueType>(message);
+        const Message<ValueType> *const typed_message = MessageCast::CastMessage<ValueType>(message);
         if (typed_message) {
             // Call the handler, passing it the message value and from address.
             (object_->*handler_function_)(typed_message->Value(), typed_message->From());
@@ -9,6 +9,8 @@
 
 #include "AF/detail/messages/message_interface.h"
 
+#include "AF/detail/utils/type_id.h"
+
 
 namespace AF
 {
@@ -20,22 +22,27 @@ namespace Detail
  */
 class ReceiverHandlerInterface : public List<ReceiverHandlerInterface>::Node {
 public:
-    AF_FORCEINLINE ReceiverHandlerInterface() {
+    AF_FORCEINLINE explicit ReceiverHandlerInterface(const TypeId handler_type_id)
+      : handler_type_id_(handler_type_id) {
     }
 
     inline virtual ~ReceiverHandlerInterface() {
     }
 
     /*
-     * Returns the unique name of the message type handled by this handler.
+     * Returns the identifier of the concrete type of this handler.
      */
-    virtual const char *GetMessageTypeName() const = 0;
+    AF_FORCEINLINE TypeId GetHandlerTypeId() const {
+        return handler_type_id_;
+    }
 
     virtual bool Handle(const MessageInterface *const message) const = 0;
 
 private:
     ReceiverHandlerInterface(const ReceiverHandlerInterface &other);
     ReceiverHandlerInterface &operator=(const ReceiverHandlerInterface &other);
+
+    const TypeId handler_type_id_;      // Identifier of the concrete handler type.
 };
 
 
@@ -6,14 +6,18 @@
 #include "AF/assert.h"
 #include "AF/basic_types.h"
 #include "AF/defines.h"
+#include "AF/flow_control.h"
+#include "AF/message_priority.h"
+#include "AF/overflow_policy.h"
 
-
+#include "AF/detail/containers/mpsc_queue.h"
 #include "AF/detail/containers/queue.h"
 
 #include "AF/detail/messages/message_interface.h"
 
 #include "AF/detail/strings/string.h"
 
+#include "AF/detail/threading/atomic.h"
 #include "AF/detail/threading/spin_lock.h"
 
 
@@ -27,6 +31,33 @@ namespace Detail
 
 /*
  * An individual mailbox with a specific address.
+ *
+ * Messages are pushed into the mailbox without locking, by any number of sending threads,
+ * and are consumed by the single worker thread processing the mailbox at any one time.
+ * The count of queued messages is maintained atomically, and the sender whose push makes
+ * the mailbox non-empty is the one responsible for scheduling it.
+ *
+ * The mailbox lock protects the registered actor, the pin count, and deferred messages.
+ *
+ * A mailbox can be given a capacity, checked against the message count by senders before they
+ * push. The check isn't atomic with the push, so concurrent senders can each overshoot it by one.
+ *
+ * A mailbox can also be flow-controlled, with a window of credits. The credits available are the
+ * window less the message count and the credits claimed by senders that are still pushing, so
+ * processing a message returns its credit. Senders claim a credit atomically before pushing, so
+ * concurrent senders can't overrun the window together. Messages sent while there's no credit can
+ * be deferred, held in order outside the queue until credit is returned.
+ *
+ * High-priority messages are pushed into a second queue, which the consumer drains first.
+ * They're counted in that queue before being counted in the mailbox, so a consumer that sees
+ * the mailbox count always sees the high-priority messages it includes.
+ *
+ * Deregistering the actor retires the mailbox. Its directory index is freed for reuse once
+ * the mailbox is empty, by whichever of the deregistering thread and the worker thread that
+ * empties it gets to release it first. Senders enter the mailbox before checking that their
+ * address is current, and leave it once they've pushed, and the mailbox can't be released
+ * while any are inside, so a sender that finds its address current can't push into a mailbox
+ * that's been reused. The last sender to leave a retired mailbox may have to release it too.
  */
 class AF_PREALIGN(AF_CACHELINE_ALIGNMENT) Mailbox : public Queue<Mailbox>::Node {
 public:
@@ -34,32 +65,125 @@ public:
 
     // Gets the string name of the mailbox.
     // The name is arbitrary and identifies the actor within the context of the whole system,
-    inline String GetName() const;
+    inline const String &GetName() const;
 
     inline void SetName(const String &name);
 
+    // Locks the mailbox, protecting the registered actor and pin count.
     inline void Lock() const;
 
     inline void Unlock() const;
 
     inline bool Empty() const;
 
-    inline void Push(MessageInterface *const message);
+    // Pushes a message into the mailbox. May be called by any thread, without locking.
+    // Returns true if the mailbox was previously empty, in which case the caller must schedule it.
+    inline bool Push(MessageInterface *const message);
 
-    inline MessageInterface *Front() const;
+    // Returns the oldest high-priority message in the mailbox, or the oldest message
+    // if there are none. The mailbox must not be empty.
+    // Only the thread processing the mailbox may call Front.
+    inline MessageInterface *Front();
 
-    inline MessageInterface *Pop();
+    // Removes the message returned by Front, returning true if more messages remain.
+    // In that case the caller must reschedule the mailbox.
+    // Only the thread processing the mailbox may call Pop.
+    inline bool Pop();
 
+    // Returns the number of messages in the mailbox, including any being processed.
     inline uint32_t Count() const;
 
+    // Returns true if the mailbox holds any high-priority messages.
+    inline bool HasHighPriority() const;
+
+    // Sets the maximum number of messages held by the mailbox, or zero for no limit,
+    // and how messages sent to the mailbox once it's full are treated.
+    inline void SetCapacity(const uint32_t capacity, const OverflowPolicy policy);
+
+    inline uint32_t GetCapacity() const;
+
+    inline OverflowPolicy GetOverflowPolicy() const;
+
+    // Returns true if the mailbox holds at least as many messages as its capacity.
+    inline bool IsFull() const;
+
+    // Returns true if the mailbox holds more messages than its capacity.
+    inline bool IsOverflowing() const;
+
+    // Sets the credit window of the mailbox, or zero to disable flow control,
+    // and how sends made when there's no credit left are treated.
+    // Also resets the count of throttled sends.
+    inline void SetCreditWindow(const uint32_t window, const FlowControlMode mode);
+
+    inline uint32_t GetCreditWindow() const;
+
+    inline FlowControlMode GetFlowControlMode() const;
+
+    // Returns true if a message can be pushed without exceeding the credit window,
+    // and there are no deferred messages it would overtake.
+    inline bool HasCredit() const;
+
+    // Claims a credit for a message about to be pushed, returning false if there's none.
+    // The caller must settle the claim once it has pushed the message.
+    inline bool ClaimCredit();
+
+    // Settles a credit claimed by ClaimCredit, after the message has been pushed and counted.
+    inline void SettleCredit();
+
+    // Defers a message while there's no credit, returning false if credit was returned in
+    // the meantime, in which case a credit is claimed and the caller should push the message.
+    inline bool Defer(MessageInterface *const message);
+
+    // Admits the oldest deferred message if there's now credit for it, returning false if not.
+    // Sets woken if admitting it made the mailbox non-empty, in which case the caller becomes
+    // responsible for scheduling the mailbox, as a sender would be.
+    inline bool Undefer(bool &woken);
+
+    // Counts a send that found no credit available.
+    inline void CountThrottled();
+
+    // Returns the number of sends that have found no credit available.
+    inline uint32_t GetThrottledCount() const;
+
+    // Counts a thread blocked waiting for credit, or one that has stopped waiting.
+    inline void AddCreditWaiter();
+
+    inline void RemoveCreditWaiter();
+
+    // Returns true if any threads are blocked waiting for credit.
+    inline bool HasCreditWaiters() const;
+
     // Registers an actor with this mailbox.
     inline void RegisterActor(Actor *const actor);
 
-    // Deregisters the actor registered with this mailbox.
+    // Deregisters the actor registered with this mailbox, retiring the mailbox.
     inline void DeregisterActor();
 
     inline Actor *GetActor() const;
 
+    // Returns true if the actor has been deregistered and the mailbox not yet released.
+    inline bool IsRetired() const;
+
+    // Claims a retired mailbox for release, returning true for only one caller.
+    // Fails while senders are inside the mailbox, or a worker thread has it pinned,
+    // since they release it instead. The caller must hold the mailbox lock, and frees
+    // the index of the mailbox, which may then be reused.
+    inline bool Release();
+
+    // Enters the mailbox to send to it, holding off its release.
+    // Returns false, without entering, if the mailbox has already been released.
+    inline bool Enter();
+
+    // Leaves a mailbox entered to send to it.
+    // Returns true if the mailbox is retired and no other senders are inside, in which
+    // case the caller should release it if it's empty.
+    inline bool Leave();
+
+    // Sets the index of the mailbox within its directory.
+    inline void SetIndex(const uint32_t index);
+
+    inline uint32_t GetIndex() const;
+
     // Pins the mailbox, preventing the registered actor from being changed.
     inline void Pin();
 
@@ -74,14 +198,32 @@ public:
 
 private:
 
-    typedef Queue<MessageInterface> MessageQueue;
+    typedef MpscQueue<MessageInterface> MessageQueue;
+
+    static const uint32_t RETIRED = 0x80000000;     // State flag set once the actor is deregistered.
+    static const uint32_t RELEASED = 0x40000000;    // State flag set once the mailbox is released, until it's reused.
 
     MessageQueue queue_;                        // Queue of messages in this mailbox.
+    MessageQueue high_queue_;                   // Queue of high-priority messages in this mailbox.
+    bool front_high_;                           // Whether the message returned by Front is high-priority.
     String name_;                               // Name of this mailbox.
     Actor *actor_;                              // Pointer to the actor registered with this mailbox, if any.
     mutable SpinLock spin_lock_;                // Thread synchronization object protecting the mailbox.
-    uint32_t message_count_;                    // Size of the message queue.
+    Atomic::UInt32 message_count_;              // Size of the message queue.
+    Atomic::UInt32 high_count_;                 // Size of the high-priority message queue.
+    Atomic::UInt32 capacity_;                   // Maximum size of the message queue, or zero if unbounded.
+    Atomic::UInt32 overflow_policy_;            // Treatment of messages sent once the queue is full.
+    Atomic::UInt32 credit_window_;              // Number of credits granted to senders, or zero if not flow-controlled.
+    Atomic::UInt32 flow_control_mode_;          // Treatment of sends made without credit.
+    Atomic::UInt32 claimed_count_;              // Number of credits claimed by senders whose messages aren't yet counted.
+    Atomic::UInt32 deferred_count_;             // Number of deferred messages.
+    Atomic::UInt32 credit_waiters_;             // Number of threads blocked waiting for credit.
+    Atomic::UInt32 throttled_count_;            // Number of sends that found no credit.
+    Atomic::UInt32 state_;                      // Number of senders inside the mailbox, and whether it's retired or released.
+    MessageInterface *deferred_head_;           // Oldest deferred message, protected by the lock.
+    MessageInterface *deferred_tail_;           // Newest deferred message, protected by the lock.
     uint32_t pin_count_;                        // Pinning a mailboxes prevents the actor from being deregistered.
+    uint32_t index_;                            // Index of the mailbox within its directory.
     uint64_t timestamp_;                        // Used for measuring mailbox scheduling latencies.
 
 } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
@@ -89,15 +231,30 @@ private:
 
 inline Mailbox::Mailbox() 
   : queue_(),
+    high_queue_(),
+    front_high_(false),
     name_(),
     actor_(0),
     spin_lock_(),
     message_count_(0),
+    high_count_(0),
+    capacity_(0),
+    overflow_policy_(OVERFLOW_POLICY_REJECT),
+    credit_window_(0),
+    flow_control_mode_(FLOW_CONTROL_DEFER),
+    claimed_count_(0),
+    deferred_count_(0),
+    credit_waiters_(0),
+    throttled_count_(0),
+    state_(0),
+    deferred_head_(0),
+    deferred_tail_(0),
     pin_count_(0),
+    index_(0),
     timestamp_(0) {
 }
 
-AF_FORCEINLINE String Mailbox::GetName() const {
+AF_FORCEINLINE const String &Mailbox::GetName() const {
     return name_;
 }
 
@@ -114,25 +271,203 @@ AF_FORCEINLINE void Mailbox::Unlock() const {
 }
 
 AF_FORCEINLINE bool Mailbox::Empty() const {
-    return queue_.Empty();
+    return (message_count_.Load() == 0);
 }
 
-AF_FORCEINLINE void Mailbox::Push(MessageInterface *const message) {
-    queue_.Push(message);
-    ++message_count_;
+AF_FORCEINLINE bool Mailbox::Push(MessageInterface *const message) {
+    // The message is linked into the queue before it's counted, so by the time
+    // the count says the mailbox is non-empty the consumer is able to reach it.
+    if (message->GetPriority() == MESSAGE_PRIORITY_HIGH) {
+        high_queue_.Push(message);
+        high_count_.Increment();
+    } else {
+        queue_.Push(message);
+    }
+
+    return (message_count_.Increment() == 1);
 }
 
-AF_FORCEINLINE MessageInterface *Mailbox::Front() const {
-    return queue_.Front();
+AF_FORCEINLINE MessageInterface *Mailbox::Front() {
+    AF_ASSERT(message_count_.Load() > 0);
+
+    // Remember which queue the message came from, in case a high-priority
+    // message arrives before it's popped.
+    front_high_ = (high_count_.Load() > 0);
+    return front_high_ ? high_queue_.Front() : queue_.Front();
 }
 
-AF_FORCEINLINE MessageInterface *Mailbox::Pop() {
-    --message_count_;
-    return queue_.Pop();
+AF_FORCEINLINE bool Mailbox::Pop() {
+    // The message is unlinked before it's uncounted, so once the count drops to
+    // zero a sender can schedule the mailbox for processing by another thread.
+    if (front_high_) {
+        high_queue_.Pop();
+        high_count_.Decrement();
+    } else {
+        queue_.Pop();
+    }
+
+    return (message_count_.Decrement() > 0);
 }
 
 AF_FORCEINLINE uint32_t Mailbox::Count() const {
-    return message_count_;
+    return message_count_.Load();
+}
+
+AF_FORCEINLINE bool Mailbox::HasHighPriority() const {
+    return (high_count_.Load() > 0);
+}
+
+AF_FORCEINLINE void Mailbox::SetCapacity(const uint32_t capacity, const OverflowPolicy policy) {
+    overflow_policy_.Store(static_cast<uint32_t>(policy));
+    capacity_.Store(capacity);
+}
+
+AF_FORCEINLINE uint32_t Mailbox::GetCapacity() const {
+    return capacity_.Load();
+}
+
+AF_FORCEINLINE OverflowPolicy Mailbox::GetOverflowPolicy() const {
+    return static_cast<OverflowPolicy>(overflow_policy_.Load());
+}
+
+AF_FORCEINLINE bool Mailbox::IsFull() const {
+    const uint32_t capacity(capacity_.Load());
+    return (capacity && message_count_.Load() >= capacity);
+}
+
+AF_FORCEINLINE bool Mailbox::IsOverflowing() const {
+    const uint32_t capacity(capacity_.Load());
+    return (capacity && message_count_.Load() > capacity);
+}
+
+AF_FORCEINLINE void Mailbox::SetCreditWindow(const uint32_t window, const FlowControlMode mode) {
+    flow_control_mode_.Store(static_cast<uint32_t>(mode));
+    throttled_count_.Store(0);
+    credit_window_.Store(window);
+}
+
+AF_FORCEINLINE uint32_t Mailbox::GetCreditWindow() const {
+    return credit_window_.Load();
+}
+
+AF_FORCEINLINE FlowControlMode Mailbox::GetFlowControlMode() const {
+    return static_cast<FlowControlMode>(flow_control_mode_.Load());
+}
+
+AF_FORCEINLINE bool Mailbox::HasCredit() const {
+    const uint32_t window(credit_window_.Load());
+    return (window == 0 || (deferred_count_.Load() == 0 && message_count_.Load() + claimed_count_.Load() < window));
+}
+
+AF_FORCEINLINE bool Mailbox::ClaimCredit() {
+    // Claims are counted before they're pushed and settled after, so a message in flight is
+    // briefly counted twice, which errs on the side of the window. The claim count is only
+    // ever raised by this exchange, so two senders can't both take the last credit.
+    uint32_t claimed(claimed_count_.Load());
+    while (true) {
+        const uint32_t window(credit_window_.Load());
+        if (window != 0 && (deferred_count_.Load() != 0 || message_count_.Load() + claimed >= window)) {
+            return false;
+        }
+
+        if (claimed_count_.CompareExchangeAcquire(claimed, claimed + 1)) {
+            return true;
+        }
+    }
+}
+
+AF_FORCEINLINE void Mailbox::SettleCredit() {
+    AF_ASSERT(claimed_count_.Load() > 0);
+    claimed_count_.Decrement();
+}
+
+inline bool Mailbox::Defer(MessageInterface *const message) {
+    spin_lock_.Lock();
+
+    // The consumer may empty the mailbox and miss this message without taking the lock,
+    // so the caller must then admit deferred messages itself, as the consumer would.
+    const bool deferred(!ClaimCredit());
+    if (deferred) {
+        message->next_.store(0, std::memory_order_relaxed);
+        if (deferred_tail_) {
+            deferred_tail_->next_.store(message, std::memory_order_relaxed);
+        } else {
+            deferred_head_ = message;
+        }
+
+        deferred_tail_ = message;
+        deferred_count_.Increment();
+    }
+
+    spin_lock_.Unlock();
+
+    return deferred;
+}
+
+inline bool Mailbox::Undefer(bool &woken) {
+    // Consumers count out messages before checking for deferred ones, and deferring senders
+    // count in their messages before calling this too, so at least one of them sees the other.
+    if (deferred_count_.Load() == 0) {
+        return false;
+    }
+
+    bool admitted(false);
+
+    spin_lock_.Lock();
+
+    // The credit is claimed like any other sender's, so senders that saw no deferred messages
+    // can't overfill the window. A window reduced to zero admits all the deferred messages.
+    if (deferred_head_) {
+        const uint32_t window(credit_window_.Load());
+        uint32_t claimed(claimed_count_.Load());
+        while (window == 0 || message_count_.Load() + claimed < window) {
+            if (claimed_count_.CompareExchangeAcquire(claimed, claimed + 1)) {
+                admitted = true;
+                break;
+            }
+        }
+    }
+
+    // The message is pushed under the lock so messages admitted by different threads stay in order.
+    if (admitted) {
+        MessageInterface *const message(deferred_head_);
+        deferred_head_ = static_cast<MessageInterface *>(message->next_.load(std::memory_order_relaxed));
+        if (deferred_head_ == 0) {
+            deferred_tail_ = 0;
+        }
+
+        deferred_count_.Decrement();
+
+        if (Push(message)) {
+            woken = true;
+        }
+
+        SettleCredit();
+    }
+
+    spin_lock_.Unlock();
+
+    return admitted;
+}
+
+AF_FORCEINLINE void Mailbox::CountThrottled() {
+    throttled_count_.Increment();
+}
+
+AF_FORCEINLINE uint32_t Mailbox::GetThrottledCount() const {
+    return throttled_count_.Load();
+}
+
+AF_FORCEINLINE void Mailbox::AddCreditWaiter() {
+    credit_waiters_.Increment();
+}
+
+AF_FORCEINLINE void Mailbox::RemoveCreditWaiter() {
+    credit_waiters_.Decrement();
+}
+
+AF_FORCEINLINE bool Mailbox::HasCreditWaiters() const {
+    return (credit_waiters_.Load() != 0);
 }
 
 AF_FORCEINLINE void Mailbox::RegisterActor(Actor *const actor) {
@@ -142,6 +477,11 @@ AF_FORCEINLINE void Mailbox::RegisterActor(Actor *const actor) {
     AF_ASSERT(actor);
 
     actor_ = actor;
+
+    // Senders holding stale addresses may still be passing through, so keep their count.
+    uint32_t state(state_.Load());
+    while (!state_.CompareExchange(state, state & ~RELEASED)) {
+    }
 }
 
 AF_FORCEINLINE void Mailbox::DeregisterActor() {
@@ -150,12 +490,61 @@ AF_FORCEINLINE void Mailbox::DeregisterActor() {
     AF_ASSERT(actor_ != 0);
 
     actor_ = 0;
+
+    uint32_t state(state_.Load());
+    while (!state_.CompareExchange(state, state | RETIRED)) {
+    }
+
+    // Release the name of the departed actor, so it can be reclaimed by the string pool.
+    name_ = String();
 }
 
 AF_FORCEINLINE Actor *Mailbox::GetActor() const {
     return actor_;
 }
 
+AF_FORCEINLINE bool Mailbox::IsRetired() const {
+    return ((state_.Load() & RETIRED) != 0);
+}
+
+AF_FORCEINLINE bool Mailbox::Release() {
+    // A worker thread touches the mailbox until it unpins it, under the lock.
+    if (pin_count_ != 0) {
+        return false;
+    }
+
+    // Only a retired mailbox with no senders inside can be released.
+    uint32_t state(RETIRED);
+    while (!state_.CompareExchange(state, RELEASED)) {
+        if (state != RETIRED) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+AF_FORCEINLINE bool Mailbox::Enter() {
+    if (state_.Increment() & RELEASED) {
+        state_.Decrement();
+        return false;
+    }
+
+    return true;
+}
+
+AF_FORCEINLINE bool Mailbox::Leave() {
+    return (state_.Decrement() == RETIRED);
+}
+
+AF_FORCEINLINE void Mailbox::SetIndex(const uint32_t index) {
+    index_ = index;
+}
+
+AF_FORCEINLINE uint32_t Mailbox::GetIndex() const {
+    return index_;
+}
+
 AF_FORCEINLINE void Mailbox::Pin() {
     ++pin_count_;
 }
@@ -7,12 +7,16 @@
 #include "AF/assert.h"
 #include "AF/basic_types.h"
 #include "AF/defines.h"
+#include "AF/message_priority.h"
 
 #include "AF/detail/messages/message_interface.h"
 #include "AF/detail/messages/message_size.h"
 #include "AF/detail/messages/message_traits.h"
 
+#include "AF/detail/utils/type_id.h"
+
 #include <new>
+#include <utility>
 
 
 namespace AF
@@ -36,24 +40,69 @@ public:
         return MessageSize<ValueType>::GetSize() + sizeof(ThisType);
     }
 
+    // Returns the memory block size required to initialize the given number of messages sharing one value.
+    AF_FORCEINLINE static uint32_t GetSharedSize(const uint32_t count) {
+        return MessageSize<ValueType>::GetSize() + count * sizeof(ThisType) + sizeof(SharedFooter);
+    }
+
     // Returns the memory block alignment required to initialize a message of this type.
+    // The block holds both the value and the message object that follows it, so must
+    // satisfy the natural alignment of both as well as any explicitly registered alignment.
     AF_FORCEINLINE static uint32_t GetAlignment() {
-        return MessageAlignment<ValueType>::ALIGNMENT;
+        uint32_t alignment(MessageAlignment<ValueType>::ALIGNMENT);
+
+        if (alignment < AF_ALIGNOF(ValueType)) {
+            alignment = AF_ALIGNOF(ValueType);
+        }
+
+        if (alignment < AF_ALIGNOF(ThisType)) {
+            alignment = AF_ALIGNOF(ThisType);
+        }
+
+        return alignment;
     }
 
-    // Initializes a message of this type in the provided memory block.
-    // The block is allocated and freed by the caller.
-    AF_FORCEINLINE static ThisType *Initialize(void *const block, const ValueType &value, const Address &from) {
+    // Initializes a message of this type in the provided memory block, constructing the value
+    // from the given arguments. The block is allocated and freed by the caller.
+    template <class... ArgTypes>
+    AF_FORCEINLINE static ThisType *Initialize(void *const block, const Address &from, ArgTypes &&... args) {
         AF_ASSERT(block);
 
         // Instantiate a new instance of the value type in aligned position at the start of the buffer.
-        // We assume that the message value type can be copy-constructed.
-        // Messages are explicitly copied to avoid shared memory.
-        ValueType *const pvalue = new (block) ValueType(value);
+        // Sent values are copied or moved into the message, so no memory is shared with the sender.
+        ValueType *const pvalue = new (block) ValueType(std::forward<ArgTypes>(args)...);
 
         // Allocate the message object immediately after the value, passing it the value's address.
         char *const pobject(reinterpret_cast<char *>(pvalue) + MessageSize<ValueType>::GetSize());
-        return new (pobject) ThisType(pvalue, from);
+        return new (pobject) ThisType(pvalue, GetSize(), from, false);
+    }
+
+    // Initializes the given number of messages sharing one value in the provided memory block,
+    // which must be of the size returned by GetSharedSize. Returns the first message of an array.
+    // The value is constructed once, followed by the messages and a footer counting them.
+    template <class... ArgTypes>
+    AF_FORCEINLINE static ThisType *InitializeShared(
+        void *const block,
+        const uint32_t count,
+        const Address &from,
+        ArgTypes &&... args) {
+        AF_ASSERT(block);
+        AF_ASSERT(count > 0);
+
+        const uint32_t block_size(GetSharedSize(count));
+        ValueType *const pvalue = new (block) ValueType(std::forward<ArgTypes>(args)...);
+
+        char *const pobjects(reinterpret_cast<char *>(pvalue) + MessageSize<ValueType>::GetSize());
+        ThisType *const messages(reinterpret_cast<ThisType *>(pobjects));
+        for (uint32_t index = 0; index < count; ++index) {
+            new (messages + index) ThisType(pvalue, block_size, from, true);
+        }
+
+        SharedFooter *const footer(messages->GetSharedFooter());
+        new (&footer->references_) std::atomic<uint32_t>(count);
+        footer->destroy_value_ = &DestroyValue;
+
+        return messages;
     }
 
     // Returns the name of the message type.
@@ -71,9 +120,8 @@ public:
 
     // Returns the size in bytes of the message value.
     virtual uint32_t GetMessageSize() const {
-        // Calculate the size of the message value itself. There's no padding between the
-        // message value block and the Message object that follows it.
-        return GetBlockSize() - static_cast<uint32_t>(sizeof(ThisType));
+        // The value occupies the start of the block, up to the first Message object.
+        return MessageSize<ValueType>::GetSize();
     }
 
     // Gets the value carried by the message.
@@ -82,12 +130,22 @@ public:
         return *reinterpret_cast<const ValueType *>(GetBlock());
     }
 
+    // Gets the value carried by the message, so it can be moved out by a handler.
+    // A moved-from value is still destructed by Release as usual.
+    AF_FORCEINLINE ValueType &Value() {
+        return *reinterpret_cast<ValueType *>(GetBlock());
+    }
+
 private:
-    AF_FORCEINLINE Message(void *const block, const Address &from) 
-      : MessageInterface(from, block, ThisType::GetSize()) {
+    AF_FORCEINLINE Message(void *const block, const uint32_t block_size, const Address &from, const bool shared) 
+      : MessageInterface(from, block, block_size, TypeIdOf<ValueType>::Get(), shared, MessagePriorityTraits<ValueType>::PRIORITY) {
         AF_ASSERT(block);
     }
 
+    static void DestroyValue(void *const value) {
+        reinterpret_cast<ValueType *>(value)->~ValueType();
+    }
+
     Message(const Message &other);
     Message &operator=(const Message &other);
 };
@@ -10,6 +10,8 @@
 #include "AF/detail/messages/message.h"
 #include "AF/detail/messages/message_interface.h"
 
+#include <utility>
+
 
 namespace AF
 {
@@ -21,23 +23,42 @@ namespace Detail
  */
 class MessageCreator {
 public:
-    template <class ValueType>
+    /*
+     * Creates a message whose value is constructed in place from the given arguments.
+     */
+    template <class ValueType, class... ArgTypes>
     inline static Message<ValueType> *Create(
         AllocatorInterface *const message_allocator,
-        const ValueType &value,
-        const Address &from);
+        const Address &from,
+        ArgTypes &&... args);
+
+    /*
+     * Creates an array of messages that share one value, constructed in place from the given
+     * arguments, in a single memory block. Each message is destroyed separately as usual.
+     */
+    template <class ValueType, class... ArgTypes>
+    inline static Message<ValueType> *CreateShared(
+        AllocatorInterface *const message_allocator,
+        const uint32_t count,
+        const Address &from,
+        ArgTypes &&... args);
 
     inline static void Destroy(
         AllocatorInterface *const message_allocator,
         MessageInterface *const message);
+
+private:
+    inline static void DestroyShared(
+        AllocatorInterface *const message_allocator,
+        MessageInterface *const message);
 };
 
 
-template <class ValueType>
+template <class ValueType, class... ArgTypes>
 AF_FORCEINLINE Message<ValueType> *MessageCreator::Create(
     AllocatorInterface *const message_allocator,
-    const ValueType &value,
-    const Address &from) {
+    const Address &from,
+    ArgTypes &&... args) {
 
     typedef Message<ValueType> MessageType;
     const uint32_t block_size(MessageType::GetSize());
@@ -48,7 +69,26 @@ AF_FORCEINLINE Message<ValueType> *MessageCreator::Create(
     // The free list is thread-safe so we don't need to lock it ourselves.
     void *const block = message_allocator->AllocateAligned(block_size, block_alignment);
     if (block) {
-        return MessageType::Initialize(block, value, from);
+        return MessageType::Initialize(block, from, std::forward<ArgTypes>(args)...);
+    }
+
+    return 0;
+}
+
+template <class ValueType, class... ArgTypes>
+inline Message<ValueType> *MessageCreator::CreateShared(
+    AllocatorInterface *const message_allocator,
+    const uint32_t count,
+    const Address &from,
+    ArgTypes &&... args) {
+
+    typedef Message<ValueType> MessageType;
+    const uint32_t block_size(MessageType::GetSharedSize(count));
+    const uint32_t block_alignment(MessageType::GetAlignment());
+
+    void *const block = message_allocator->AllocateAligned(block_size, block_alignment);
+    if (block) {
+        return MessageType::InitializeShared(block, count, from, std::forward<ArgTypes>(args)...);
     }
 
     return 0;
@@ -57,6 +97,11 @@ AF_FORCEINLINE Message<ValueType> *MessageCreator::Create(
 AF_FORCEINLINE void MessageCreator::Destroy(
     AllocatorInterface *const message_allocator,
     MessageInterface *const message) {
+    if (message->IsShared()) {
+        DestroyShared(message_allocator, message);
+        return;
+    }
+
     // Call release on the message to give it chance to destruct its value type.
     message->Release();
 
@@ -68,6 +113,24 @@ AF_FORCEINLINE void MessageCreator::Destroy(
     message_allocator->FreeWithSize(message->GetBlock(), message->GetBlockSize());
 }
 
+inline void MessageCreator::DestroyShared(
+    AllocatorInterface *const message_allocator,
+    MessageInterface *const message) {
+    void *const block(message->GetBlock());
+    const uint32_t block_size(message->GetBlockSize());
+    MessageInterface::SharedFooter *const footer(message->GetSharedFooter());
+
+    // Destruct our own message object while the block is still ours to touch.
+    message->~MessageInterface();
+
+    // The last message to go destroys the shared value and frees the block.
+    // The release-acquire ordering makes all uses of the value happen before its destruction.
+    if (footer->references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        footer->destroy_value_(block);
+        message_allocator->FreeWithSize(block, block_size);
+    }
+}
+
 
 } // namespace Detail
 } // namespace AF
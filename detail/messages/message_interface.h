@@ -6,8 +6,13 @@
 #include "AF/assert.h"
 #include "AF/basic_types.h"
 #include "AF/defines.h"
+#include "AF/message_priority.h"
 
-#include "AF/detail/containers/queue.h"
+#include "AF/detail/containers/mpsc_queue.h"
+
+#include "AF/detail/utils/type_id.h"
+
+#include <atomic>
 
 
 namespace AF
@@ -18,14 +23,21 @@ namespace Detail
 /*
  * Interface describing the generic API of the message class template.
  */
-class MessageInterface : public Queue<MessageInterface>::Node {
+class MessageInterface : public MpscQueue<MessageInterface>::Node {
 public:
+    /*
+     * Footer at the end of a memory block shared by several messages carrying the same value.
+     * The value is destroyed and the block freed when the last of the messages is destroyed.
+     */
+    struct SharedFooter {
+        std::atomic<uint32_t> references_;     // Number of messages still referencing the block.
+        void (*destroy_value_)(void *value);    // Destructs the value at the start of the block.
+    };
 
     /*
      * Gets the address from which the message was sent.
-     * TODO: Force-inline
      */
-    inline Address From() const {
+    AF_FORCEINLINE const Address &From() const {
         return from_;
     }
 
@@ -45,6 +57,44 @@ public:
         return block_size_;
     }
 
+    /*
+     * Returns true if the message shares its memory block, and value, with other messages.
+     */
+    AF_FORCEINLINE bool IsShared() const {
+        return shared_;
+    }
+
+    /*
+     * Returns the footer of a shared memory block.
+     */
+    AF_FORCEINLINE SharedFooter *GetSharedFooter() const {
+        AF_ASSERT(shared_);
+        return reinterpret_cast<SharedFooter *>(static_cast<char *>(block_) + block_size_ - sizeof(SharedFooter));
+    }
+
+    /*
+     * Returns the priority with which the message was sent.
+     */
+    AF_FORCEINLINE MessagePriority GetPriority() const {
+        return static_cast<MessagePriority>(priority_);
+    }
+
+    /*
+     * Sets the priority of the message, overriding the default priority of its value type.
+     * Must be called before the message is sent.
+     */
+    AF_FORCEINLINE void SetPriority(const MessagePriority priority) {
+        priority_ = static_cast<uint8_t>(priority);
+    }
+
+    /*
+     * Returns the identifier of the message value type.
+     * Messages are matched to handlers by comparing type identifiers.
+     */
+    AF_FORCEINLINE TypeId GetTypeId() const {
+        return type_id_;
+    }
+
     /*
      * Returns the message value as blind data.
      */
@@ -62,7 +112,7 @@ public:
      * Returns the name of the message type.
      * This uniquely identifies the type of the message value.
      *
-     * Unless explicitly specified to avoid C++ RTTI, message names are null.
+     * Message names are null unless the type is registered with AF_REGISTER_MESSAGE.
      */
     virtual const char *TypeName() const = 0;
 
@@ -79,15 +129,23 @@ protected:
      * from: The address from which the message was sent.
      * block: The memory block containing the message.
      * block_size: The size of the memory block containing the message.
-     * type_name: String identifier uniquely identifying the type of the message value.
+     * type_id: Identifier uniquely identifying the type of the message value.
+     * shared: Whether the memory block is shared with other messages.
+     * priority: The priority with which the message is sent.
      */
     AF_FORCEINLINE MessageInterface(
         const Address &from,
         void *const block,
-        const uint32_t block_size) 
+        const uint32_t block_size,
+        const TypeId type_id,
+        const bool shared,
+        const MessagePriority priority) 
       : from_(from),
         block_(block),
-        block_size_(block_size) {
+        block_size_(block_size),
+        shared_(shared),
+        priority_(static_cast<uint8_t>(priority)),
+        type_id_(type_id) {
     }
 
 private:
@@ -98,6 +156,9 @@ private:
     const Address from_;            // The address from which the message was sent.
     void *const block_;             // Pointer to the memory block containing the message.
     const uint32_t block_size_;     // Total size of the message memory block in bytes.
+    const bool shared_;             // Whether the memory block is shared with other messages.
+    uint8_t priority_;              // Priority with which the message is sent.
+    const TypeId type_id_;          // Identifier of the type of the message value.
 };
 
 
@@ -18,17 +18,13 @@ template <class ValueType>
 class MessageSize {
 public:
     AF_FORCEINLINE static uint32_t GetSize() {
-        uint32_t value_size(sizeof(ValueType));
-        const uint32_t minimum_allocation_size(4);
+        const uint32_t value_size(sizeof(ValueType));
+        const uint32_t pointer_size(sizeof(void *));
 
         // Empty structs passed as message values have a size of one byte, which we don't like.
-        // To be on the safe side we round every allocation up to at least four bytes.
-        // If we don't then the data that follows won't be word-aligned.
-        if (value_size < minimum_allocation_size) {
-            value_size = minimum_allocation_size;
-        }
-
-        return value_size;
+        // The message object that follows the value contains pointers, so we round every
+        // allocation up to a multiple of the pointer size to keep the data that follows aligned.
+        return (value_size + pointer_size - 1) & ~(pointer_size - 1);
     }
 
 private:
@@ -13,15 +13,12 @@ namespace Detail
  * The MessageTraits template can be specialized for individual message types
  * in order to label the types with their string names.
  *
- * Types with null names are matched by means of dynamic_cast, which
- * relies on RTTI (Runtime Type Information) 
+ * Type names are informational only: messages are matched to handlers
+ * by compile-time type identifiers, whether or not the type is registered.
  */
 template <class ValueType>
 struct MessageTraits {
     // Indicates whether the message type has an explicit name.
-    // Message types for which have valid type names are identified
-    // using their names rather than with built-in C++ Runtime Type Information
-    // (RTTI) via dynamic_cast.
     static const bool HAS_TYPE_NAME = false;
     
     // The unique name of the type.
@@ -6,9 +6,11 @@
 #include "AF/basic_types.h"
 #include "AF/defines.h"
 
+#include "AF/detail/threading/atomic.h"
 #include "AF/detail/threading/condition.h"
 #include "AF/detail/threading/lock.h"
 #include "AF/detail/threading/mutex.h"
+#include "AF/detail/threading/waiter_count.h"
 
 
 namespace AF
@@ -60,10 +62,14 @@ public:
     // The calling thread should not hold a lock.
     inline void ResetYield(Context *const context);
 
-    // Wakes at most one waiting thread.
+    // Wakes at most one waiting thread, returning false if no waiting thread was left unsignalled.
     // The calling thread should hold a lock while changing the protected state 
     // but should release it before calling Pulse.
-    inline void Pulse();
+    inline bool Pulse();
+
+    // Gets the number of blocked threads that haven't been pulsed yet.
+    // The calling thread should hold a lock, so that threads about to block are counted.
+    inline uint32_t Waiting() const;
 
     // Wakes all waiting threads.
     // The calling thread should hold a lock while changing the protected state 
@@ -79,10 +85,12 @@ private:
     BlockingMonitor &operator=(const BlockingMonitor &other);
 
     mutable Condition condition_;
+    WaiterCount waiters_;               // Threads blocked in Wait, and how many of them were signalled.
 };
 
 
-inline BlockingMonitor::BlockingMonitor() {
+inline BlockingMonitor::BlockingMonitor()
+  : waiters_() {
 }
 
 inline void BlockingMonitor::InitializeWorkerContext(Context *const context) {
@@ -91,8 +99,20 @@ inline void BlockingMonitor::InitializeWorkerContext(Context *const context) {
 AF_FORCEINLINE void BlockingMonitor::ResetYield(Context *const context) {
 }
 
-AF_FORCEINLINE void BlockingMonitor::Pulse() {
+AF_FORCEINLINE bool BlockingMonitor::Pulse() {
+    // Waiters register while holding the lock, which the caller has held since changing
+    // the protected state. So any thread that missed the change is counted here.
+    // Threads already signalled by earlier pulses don't need another.
+    if (!waiters_.Signal()) {
+        return false;
+    }
+
     condition_.Pulse();
+    return true;
+}
+
+AF_FORCEINLINE uint32_t BlockingMonitor::Waiting() const {
+    return waiters_.Waiting();
 }
 
 AF_FORCEINLINE void BlockingMonitor::PulseAll() {
@@ -100,7 +120,9 @@ AF_FORCEINLINE void BlockingMonitor::PulseAll() {
 }
 
 AF_FORCEINLINE void BlockingMonitor::Wait(Context *const context, LockType &lock) {
+    waiters_.Wait();
     condition_.Wait(lock.lock_);
+    waiters_.Wake();
 }
 
 
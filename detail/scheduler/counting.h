@@ -35,13 +35,17 @@ enum Counter
 {
     COUNTER_MESSAGES_PROCESSED = 0,     // Number of messages processed by the framework.
     COUNTER_YIELDS,                     // Number of times a worker thread yielded to other threads.
+    COUNTER_WAKEUPS_AVOIDED,            // Number of pushes that didn't need to wake a worker thread.
     COUNTER_LOCAL_PUSHES,               // Number of times a mailbox was pushed to a thread's local queue.
     COUNTER_SHARED_PUSHES,              // Number of times a mailbox was pushed to the shared queue.
+    COUNTER_STEALS,                     // Number of times a mailbox was stolen from another thread's queue.
     COUNTER_MAILBOX_QUEUE_MAX,          // Maximum number of messages ever seen in the actor mailboxes.
     COUNTER_QUEUE_LATENCY_LOCAL_MIN,    // Minimum recorded local queue latency in microseconds.
     COUNTER_QUEUE_LATENCY_LOCAL_MAX,    // Maximum recorded local queue latency in microseconds.
     COUNTER_QUEUE_LATENCY_SHARED_MIN,   // Minimum recorded shared queue latency in microseconds.
     COUNTER_QUEUE_LATENCY_SHARED_MAX,   // Maximum recorded shared queue latency in microseconds.
+    COUNTER_SENDS_THROTTLED,            // Number of sends to flow-controlled actors that found no credit.
+    COUNTER_HIGH_PRIORITY_PUSHES,       // Number of times a mailbox was pushed to the high-priority queue.
     MAX_COUNTERS                        // Number of counters available for querying.
 };
 
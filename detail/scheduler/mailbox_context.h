@@ -9,6 +9,7 @@
 #include "AF/detail/mailboxes/mailbox.h"
 
 #include "AF/detail/handlers/fallback_handler_collection.h"
+#include "AF/detail/handlers/message_handler_interface.h"
 
 #include "AF/detail/scheduler/scheduler_interface.h"
 
@@ -23,33 +24,135 @@ namespace Detail
  * 
  * The members of a single context are all accessed only by one worker thread
  * so we don't need to worry about shared writes, including false sharing.
+ *
+ * While a message handler is executing, mailboxes scheduled by its sends are buffered
+ * in the context and handed to the scheduler together when the handler returns, so
+ * a handler that messages many actors pushes them all to the work queue at once.
  */
 class MailboxContext {
 public:
+    static const uint32_t MAX_DEFERRED = 64;            // Maximum number of mailboxes buffered before a flush.
+
     inline MailboxContext() 
       : scheduler_(0),
         queue_context_(0),
         fallback_handlers_(0),
         message_allocator_(0),
         mailbox_(0),
+        throughput_(1),
         predicted_send_count_(0),
-        send_count_(0) {
+        send_count_(0),
+        deferring_(false),
+        deferred_count_(0) {
     }
 
+    /*
+     * Notes that the worker thread is about to execute a message handler that accepts the message.
+     * The handler's predicted send count is what the scheduler uses to spot its last send.
+     */
+    inline void BeginHandler(MessageHandlerInterface *const message_handler);
+
+    /*
+     * Notes that the worker thread has finished executing a message handler.
+     */
+    inline void EndHandler(MessageHandlerInterface *const message_handler);
+
+    /*
+     * Notes that the message being processed has no handler, so no sends are predicted.
+     */
+    inline void ClearHandler();
+
+    /*
+     * Schedules a mailbox that has received a message. Within a message handler the mailbox
+     * is buffered until the handler returns, otherwise it's scheduled immediately.
+     */
+    inline void Schedule(Mailbox *const mailbox);
+
+    /*
+     * Returns true if mailboxes scheduled through the context are currently being buffered.
+     */
+    inline bool IsDeferring() const;
+
     SchedulerInterface *scheduler_;                      // Pointer to the associated scheduler.
     void *queue_context_;                                // Pointer to the associated queue context.
     FallbackHandlerCollection *fallback_handlers_;       // Pointer to fallback handlers for undelivered messages.
     AllocatorInterface *message_allocator_;              // Pointer to message memory block allocator.
     Mailbox *mailbox_;                                   // Pointer to the mailbox that is being processed.
+    uint32_t throughput_;                                // Maximum number of messages processed per mailbox activation.
     uint32_t predicted_send_count_;                      // Number of messages predicted to be sent by the handler.
     uint32_t send_count_;                                // Messages sent so far by the handler being executed.
 
 private:
     MailboxContext(const MailboxContext &other);
     MailboxContext &operator=(const MailboxContext &other);
+
+    /*
+     * Hands all buffered mailboxes to the scheduler as a single batch.
+     */
+    inline void Flush();
+
+    bool deferring_;                                     // Whether scheduled mailboxes are being buffered.
+    uint32_t deferred_count_;                            // Number of buffered mailboxes.
+    Mailbox *deferred_[MAX_DEFERRED];                    // Mailboxes scheduled by the current handler.
 };
 
 
+AF_FORCEINLINE void MailboxContext::BeginHandler(MessageHandlerInterface *const message_handler) {
+    // Store the last send count for this handler in the context so it's available to the scheduler.
+    // Reset the message send count in the context and start counting sends for this handler.
+    predicted_send_count_ = message_handler->GetPredictedSendCount();
+    send_count_ = 0;
+    deferring_ = true;
+}
+
+AF_FORCEINLINE void MailboxContext::EndHandler(MessageHandlerInterface *const message_handler) {
+    deferring_ = false;
+
+    if (deferred_count_) {
+        // Now the handler has returned we know exactly how many sends it made,
+        // so the last buffered mailbox is known to be scheduled by its last send.
+        predicted_send_count_ = send_count_ + deferred_count_;
+        Flush();
+    }
+
+    // Update the cached message send count for this handler.
+    // These counts are used to predict which of a handler's message sends will be its last.
+    message_handler->ReportSendCount(send_count_);
+}
+
+AF_FORCEINLINE void MailboxContext::ClearHandler() {
+    predicted_send_count_ = 0;
+    send_count_ = 0;
+}
+
+AF_FORCEINLINE void MailboxContext::Schedule(Mailbox *const mailbox) {
+    if (!deferring_) {
+        scheduler_->Schedule(this, mailbox);
+        return;
+    }
+
+    deferred_[deferred_count_++] = mailbox;
+    if (deferred_count_ == MAX_DEFERRED) {
+        Flush();
+    }
+}
+
+AF_FORCEINLINE bool MailboxContext::IsDeferring() const {
+    return deferring_;
+}
+
+AF_FORCEINLINE void MailboxContext::Flush() {
+    const uint32_t count(deferred_count_);
+    deferred_count_ = 0;
+
+    if (count == 1) {
+        scheduler_->Schedule(this, deferred_[0]);
+    } else {
+        scheduler_->ScheduleBatch(this, deferred_, count);
+    }
+}
+
+
 } // namespace Detail
 } // namespace AF
 
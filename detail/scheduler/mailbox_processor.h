@@ -4,6 +4,7 @@
 #include "AF/assert.h"
 #include "AF/basic_types.h"
 #include "AF/defines.h"
+#include "AF/overflow_policy.h"
 
 #include "AF/detail/mailboxes/mailbox.h"
 #include "AF/detail/scheduler/worker_context.h"
@@ -48,40 +49,90 @@ AF_FORCEINLINE void MailboxProcessor::Process(WorkerContext *const worker_contex
     // Remember the mailbox we're processing in the context so we can query it.
     mailbox_context->mailbox_ = mailbox;
 
-    // Pin the mailbox and get the registered actor and the first queued message.
+    // Pin the mailbox and get the registered actor.
     // At this point the mailbox shouldn't be enqueued in any other work items,
     // even if it contains more than one unprocessed message. This ensures that
-    // each mailbox is only processed by one worker thread at a time.
+    // each mailbox is only processed by one worker thread at a time, so we're
+    // the only consumer of its message queue and can read it without locking.
+    // The pin holds for the whole activation, so the actor can't be deregistered.
     mailbox->Lock();
     mailbox->Pin();
     Actor *const actor(mailbox->GetActor());
-    MessageInterface *const message(mailbox->Front());
     mailbox->Unlock();
 
-    // If an actor is registered at the mailbox then process it.
-    if (actor) {
-        actor->ProcessMessage(mailbox_context, fallback_handlers, message);
-    } else {
-        fallback_handlers->Handle(message);
+    // Process up to the throughput budget of messages before giving up the mailbox,
+    // so busy actors aren't pushed through the scheduler queue once per message.
+    uint32_t budget(mailbox_context->throughput_);
+    bool reschedule(false);
+
+    while (true) {
+        MessageInterface *const message(mailbox->Front());
+
+        // Messages at the front of a mailbox over its capacity are discarded unhandled,
+        // if its overflow policy is to drop the oldest messages.
+        const bool dropped(mailbox->IsOverflowing() && mailbox->GetOverflowPolicy() == OVERFLOW_POLICY_DROP_OLDEST);
+
+        // If an actor is registered at the mailbox then process it.
+        if (dropped) {
+            // Fall through to destroy the message.
+        } else if (actor) {
+            actor->ProcessMessage(mailbox_context, fallback_handlers, message);
+        } else {
+            fallback_handlers->Handle(message);
+        }
+
+        // Pop the message we just processed from the mailbox. The atomic message count
+        // ensures that mailboxes are always enqueued if they have unprocessed messages,
+        // but at most once at any time: if the mailbox is now empty then the next sender
+        // is responsible for scheduling it, and we mustn't touch its queue again.
+        bool more(mailbox->Pop());
+
+        // Destroy the message, but only after we've popped it from the queue.
+        MessageCreator::Destroy(message_allocator, message);
+
+        // Processing the message returned a credit, which admits a message deferred by flow control.
+        // If the mailbox had emptied then admitting a message makes us responsible for it again.
+        bool woken(false);
+        while (mailbox->Undefer(woken)) {
+        }
+
+        if (woken) {
+            more = true;
+        }
+
+        // Any credit left over is for senders blocked waiting for it.
+        if (mailbox->HasCreditWaiters()) {
+            mailbox_context->scheduler_->SignalCredit();
+        }
+
+        if (!more) {
+            break;
+        }
+
+        // Once the budget is spent, yield the mailbox to give other actors a turn.
+        if (--budget == 0) {
+            reschedule = true;
+            break;
+        }
     }
 
-    // Pop the message we just processed from the mailbox, then check whether the
-    // mailbox is now empty, and reschedule the mailbox if it's not.
-    // The locking of the mailbox here and in the main scheduling ensures that
-    // mailboxes are always enqueued if they have unprocessed messages, but at most
-    // once at any time.
+    // If the actor was deregistered while messages were still queued for it, then whichever
+    // thread empties the mailbox frees its index, unless the deregistering thread already did.
+    // The pin kept other threads from releasing it until now, and once we unlock we mustn't
+    // touch the mailbox again unless we've released it, or it's still queued with messages.
     mailbox->Lock();
     mailbox->Unpin();
-    mailbox->Pop();
+    const bool released(!reschedule && actor == 0 && mailbox->Empty() && mailbox->Release());
+    mailbox->Unlock();
 
-    if (!mailbox->Empty()) {
-        mailbox_context->scheduler_->Schedule(mailbox_context, mailbox);
+    if (reschedule) {
+        mailbox_context->scheduler_->Requeue(mailbox_context, mailbox);
+        return;
     }
 
-    mailbox->Unlock();
-
-    // Destroy the message, but only after we've popped it from the queue.
-    MessageCreator::Destroy(message_allocator, message);
+    if (released) {
+        mailbox_context->scheduler_->ReleaseMailbox(mailbox);
+    }
 }
 
 
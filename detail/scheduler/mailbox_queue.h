@@ -27,6 +27,9 @@ namespace Detail
 
 /*
  * Generic mailbox queue implementation with specialized per-thread local queues.
+ *
+ * Mailboxes holding high-priority messages are pushed to a separate shared queue,
+ * which worker threads drain before their local queues and the main shared queue.
  */
 template <class MonitorType>
 class MailboxQueue {
@@ -73,9 +76,16 @@ public:
     // Releases a previously initialized worker thread context.
     inline void ReleaseWorkerContext(ContextType *const context);
 
+    // Hands the mailbox queued in a released worker context to the remaining threads,
+    // once the thread that owned the context has terminated.
+    inline void RetireWorkerContext(ContextType *const context);
+
     // Resets to zero the given counter for the given thread context.
     inline void ResetCounter(ContextType *const context, const uint32_t counter) const;
 
+    // Increments the given counter for the given thread context.
+    inline void IncrementCounter(ContextType *const context, const uint32_t counter) const;
+
     // Gets the value of the given counter for the given thread context.
     inline uint32_t GetCounterValue(const ContextType *const context, const uint32_t counter) const;
 
@@ -97,6 +107,14 @@ public:
     // Pushes a mailbox into the queue, scheduling it for processing.
     inline void Push(ContextType *const context, Mailbox *mailbox, const SchedulerHints &hints);
 
+    // Pushes several mailboxes into the queue at once, scheduling them all for processing.
+    // The hints describe the last mailbox, which may be pushed to the local queue as in Push.
+    inline void PushBatch(
+        ContextType *const context,
+        Mailbox *const *const mailboxes,
+        const uint32_t count,
+        const SchedulerHints &hints);
+
     // Pops a previously pushed mailbox from the queue for processing.
     inline Mailbox *Pop(ContextType *const context);
 
@@ -108,14 +126,25 @@ private:
         const ContextType *const context,
         const SchedulerHints &hints);
 
-    mutable MonitorType monitor_;           // Synchronizes access to the shared queue.
+    // Pushes a mailbox onto the shared or high-priority queue. The lock must be held.
+    inline void EnqueueShared(ContextType *const context, Mailbox *const mailbox);
+
+    // Pops a mailbox from the high-priority queue, or else the shared queue. The lock must be held.
+    inline Mailbox *DequeueShared();
+
+    mutable MonitorType monitor_;           // Synchronizes access to the shared queues.
     Queue<Mailbox> shared_work_queue_;      // Work queue shared by all the threads in a scheduler.
+    Queue<Mailbox> high_work_queue_;        // Shared work queue of mailboxes holding high-priority messages.
+    Atomic::UInt32 high_count_;             // Size of the high-priority queue, read without locking.
 };
 
 
 template <class MonitorType>
 inline MailboxQueue<MonitorType>::MailboxQueue() 
-  : monitor_() {
+  : monitor_(),
+    shared_work_queue_(),
+    high_work_queue_(),
+    high_count_(0) {
 }
 
 template <class MonitorType>
@@ -146,11 +175,35 @@ inline void MailboxQueue<MonitorType>::ReleaseWorkerContext(ContextType *const c
     context->running_ = false;
 }
 
+template <class MonitorType>
+inline void MailboxQueue<MonitorType>::RetireWorkerContext(ContextType *const context) {
+    AF_ASSERT(context->running_ == false);
+
+    Mailbox *const mailbox(context->local_work_queue_);
+    if (mailbox == 0) {
+        return;
+    }
+
+    context->local_work_queue_ = 0;
+
+    {
+        typename MonitorType::LockType lock(monitor_);
+        EnqueueShared(context, mailbox);
+    }
+
+    monitor_.Pulse();
+}
+
 template <class MonitorType>
 inline void MailboxQueue<MonitorType>::ResetCounter(ContextType *const context, const uint32_t counter) const {
     Counting::Reset(context->counters_[counter].value_, counter);
 }
 
+template <class MonitorType>
+AF_FORCEINLINE void MailboxQueue<MonitorType>::IncrementCounter(ContextType *const context, const uint32_t counter) const {
+    Counting::Increment(context->counters_[counter].value_);
+}
+
 template <class MonitorType>
 AF_FORCEINLINE uint32_t MailboxQueue<MonitorType>::GetCounterValue(const ContextType *const context, const uint32_t counter) const {
     return Counting::Get(context->counters_[counter].value_);
@@ -172,9 +225,9 @@ AF_FORCEINLINE bool MailboxQueue<MonitorType>::Empty(const ContextType *const co
         return false;
     }
 
-    // Check the shared work queue.
+    // Check the shared work queues.
     typename MonitorType::LockType lock(monitor_);
-    return shared_work_queue_.Empty();
+    return shared_work_queue_.Empty() && high_work_queue_.Empty();
 }
 
 template <class MonitorType>
@@ -232,15 +285,88 @@ AF_FORCEINLINE void MailboxQueue<MonitorType>::Push(
     // Because the shared queue is accessed by multiple threads we have to protect it.
     {
         typename MonitorType::LockType lock(monitor_);
-        shared_work_queue_.Push(mailbox);
+        EnqueueShared(context, mailbox);
     }
 
     // Pulse the condition associated with the shared queue to wake a worker thread.
     // It's okay to release the lock before calling Pulse.
-    monitor_.Pulse();
+    // The monitor only signals if a worker thread is actually waiting.
+    if (!monitor_.Pulse()) {
+        Counting::Increment(context->counters_[COUNTER_WAKEUPS_AVOIDED].value_);
+    }
+
     Counting::Increment(context->counters_[COUNTER_SHARED_PUSHES].value_);
 }
 
+template <class MonitorType>
+inline void MailboxQueue<MonitorType>::PushBatch(
+    ContextType *const context,
+    Mailbox *const *const mailboxes,
+    const uint32_t count,
+    const SchedulerHints &hints) {
+    for (uint32_t index = 0; index < count; ++index) {
+#if AF_ENABLE_COUNTERS
+
+        // Timestamp the mailbox on entry.
+        mailboxes[index]->Timestamp() = Clock::GetTicks();
+
+#endif // AF_ENABLE_COUNTERS
+
+        Counting::Raise(context->counters_[COUNTER_MAILBOX_QUEUE_MAX].value_, mailboxes[index]->Count());
+    }
+
+    // Only the last mailbox in the batch can be the handler's last send, so only it can
+    // go to the local queue. A mailbox it displaces from there is pushed with the others.
+    uint32_t push_count(count);
+    Mailbox *promoted(0);
+
+    if (PreferLocalQueue(context, hints)) {
+        --push_count;
+        promoted = context->local_work_queue_;
+        context->local_work_queue_ = mailboxes[push_count];
+
+        Counting::Increment(context->counters_[COUNTER_LOCAL_PUSHES].value_);
+    }
+
+    const uint32_t total(promoted ? push_count + 1 : push_count);
+    if (total == 0) {
+        return;
+    }
+
+    // Push the batch onto the shared work queue under a single acquisition of the lock,
+    // counting the worker threads left waiting for work while we hold it.
+    uint32_t waiting(0);
+    {
+        typename MonitorType::LockType lock(monitor_);
+
+        if (promoted) {
+            EnqueueShared(context, promoted);
+        }
+
+        for (uint32_t index = 0; index < push_count; ++index) {
+            EnqueueShared(context, mailboxes[index]);
+        }
+
+        waiting = monitor_.Waiting();
+    }
+
+    // Wake a worker thread per mailbox, but no more than were waiting. The first pulse is
+    // always sent, since it also alerts spinning threads, which aren't counted as waiting.
+    const uint32_t wake(waiting < total ? (waiting ? waiting : 1) : total);
+    uint32_t woken(0);
+    while (woken < wake && monitor_.Pulse()) {
+        ++woken;
+    }
+
+    for (uint32_t index = 0; index < total; ++index) {
+        if (index >= woken) {
+            Counting::Increment(context->counters_[COUNTER_WAKEUPS_AVOIDED].value_);
+        }
+
+        Counting::Increment(context->counters_[COUNTER_SHARED_PUSHES].value_);
+    }
+}
+
 template <class MonitorType>
 AF_FORCEINLINE Mailbox *MailboxQueue<MonitorType>::Pop(ContextType *const context) {
     Mailbox *mailbox(0);
@@ -250,23 +376,32 @@ AF_FORCEINLINE Mailbox *MailboxQueue<MonitorType>::Pop(ContextType *const contex
     // messages sent outside the context of a worker thread.
     AF_ASSERT(context->shared_ == false);
 
+    // Mailboxes holding high-priority messages are taken first, even ahead of the local queue.
+    // The count is read without locking, so a mailbox pushed concurrently may be missed here,
+    // in which case it's found in the normal way below.
+    if (high_count_.Load() > 0) {
+        typename MonitorType::LockType lock(monitor_);
+        mailbox = DequeueShared();
+        counter_offset = 2;
+    }
+
     // Try to pop a mailbox off the calling thread's local work queue.
     // We only check the shared queue once the local queue is empty.
     // Note that the local queue contains at most one item.
-    if (context->local_work_queue_) {
+    if (mailbox == 0 && context->local_work_queue_) {
         mailbox = context->local_work_queue_;
         context->local_work_queue_ = 0;
-    } else {
+    } else if (mailbox == 0) {
         // Wait on the shared queue until we pop a mailbox from it.
         // Because the shared queue is accessed by multiple threads we have to protect it.
         typename MonitorType::LockType lock(monitor_);
-        while (shared_work_queue_.Empty() && context->running_ == true) {
+        while (shared_work_queue_.Empty() && high_work_queue_.Empty() && context->running_ == true) {
             Counting::Increment(context->counters_[COUNTER_YIELDS].value_);
             monitor_.Wait(&context->monitor_context_, lock);
         }
 
-        if (!shared_work_queue_.Empty()) {
-            mailbox = static_cast<Mailbox *>(shared_work_queue_.Pop());
+        mailbox = DequeueShared();
+        if (mailbox) {
             monitor_.ResetYield(&context->monitor_context_);
         }
 
@@ -306,6 +441,17 @@ AF_FORCEINLINE bool MailboxQueue<MonitorType>::PreferLocalQueue(
         return false;
     }
 
+    // Mailboxes yielding after spending their budget go behind the others waiting,
+    // rather than to the local queue, which would hand them straight back.
+    if (hints.yield_) {
+        return false;
+    }
+
+    // Mailboxes holding high-priority messages go to the high-priority queue.
+    if (hints.high_priority_) {
+        return false;
+    }
+
     if (hints.send_) {
         // If this send isn't predicted to be the last then push it to the shared queue.
         if (hints.send_index_ + 1 < hints.predicted_send_count_) {
@@ -322,6 +468,33 @@ AF_FORCEINLINE bool MailboxQueue<MonitorType>::PreferLocalQueue(
     return true;
 }
 
+template <class MonitorType>
+AF_FORCEINLINE void MailboxQueue<MonitorType>::EnqueueShared(ContextType *const context, Mailbox *const mailbox) {
+    if (mailbox->HasHighPriority()) {
+        high_work_queue_.Push(mailbox);
+        high_count_.Increment();
+
+        Counting::Increment(context->counters_[COUNTER_HIGH_PRIORITY_PUSHES].value_);
+        return;
+    }
+
+    shared_work_queue_.Push(mailbox);
+}
+
+template <class MonitorType>
+AF_FORCEINLINE Mailbox *MailboxQueue<MonitorType>::DequeueShared() {
+    if (!high_work_queue_.Empty()) {
+        high_count_.Decrement();
+        return static_cast<Mailbox *>(high_work_queue_.Pop());
+    }
+
+    if (!shared_work_queue_.Empty()) {
+        return static_cast<Mailbox *>(shared_work_queue_.Pop());
+    }
+
+    return 0;
+}
+
 
 } // namespace Detail
 } // namespace AF
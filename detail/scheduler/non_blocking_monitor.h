@@ -0,0 +1,128 @@
+#ifndef AF_DETAIL_SCHEDULER_NONBLOCKINGMONITOR_H
+#define AF_DETAIL_SCHEDULER_NONBLOCKINGMONITOR_H
+
+#include "AF/align.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include "AF/detail/threading/spin_lock.h"
+
+#include "AF/detail/utils/utils.h"
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * Non-blocking monitor thread synchronization primitive based on a spinlock.
+ * Waiting threads never sleep: they release the lock, yield the processor and poll again.
+ */
+class NonBlockingMonitor
+{
+public:
+    struct Context {
+        uint32_t backoff_;              // Backoff counter used while polling.
+    };
+
+    class LockType {
+    public:
+        friend class NonBlockingMonitor;
+
+        AF_FORCEINLINE explicit LockType(NonBlockingMonitor &monitor)
+          : spin_lock_(monitor.spin_lock_) {
+            spin_lock_.Lock();
+        }
+
+        AF_FORCEINLINE ~LockType() {
+            spin_lock_.Unlock();
+        }
+
+        AF_FORCEINLINE void Unlock() {
+            spin_lock_.Unlock();
+        }
+
+        AF_FORCEINLINE void Relock() {
+            spin_lock_.Lock();
+        }
+
+    private:
+        LockType(const LockType &other);
+        LockType &operator=(const LockType &other);
+
+        SpinLock &spin_lock_;
+    };
+
+    friend class LockType;
+
+    inline explicit NonBlockingMonitor();
+
+    // Initializes the context structure of a worker thread.
+    // The calling thread must be a worker thread.
+    inline void InitializeWorkerContext(Context *const context);
+
+    // Resets the yield backoff following a successful acquire.
+    // The calling thread should not hold a lock.
+    inline void ResetYield(Context *const context);
+
+    // Wakes at most one waiting thread, returning false if no thread was waiting.
+    // Waiting threads poll, so this does nothing.
+    inline bool Pulse();
+
+    // Gets the number of blocked threads that haven't been pulsed yet.
+    // Waiting threads poll, so none are ever blocked.
+    inline uint32_t Waiting() const;
+
+    // Wakes all waiting threads.
+    // Waiting threads poll, so this does nothing.
+    inline void PulseAll();
+
+    // Releases the lock, yields the processor and re-acquires the lock.
+    // The calling thread should hold a lock and should pass the lock as a parameter.
+    inline void Wait(Context *const context, LockType &lock);
+
+private:
+    NonBlockingMonitor(const NonBlockingMonitor &other);
+    NonBlockingMonitor &operator=(const NonBlockingMonitor &other);
+
+    SpinLock spin_lock_;
+};
+
+
+inline NonBlockingMonitor::NonBlockingMonitor() 
+  : spin_lock_() {
+}
+
+inline void NonBlockingMonitor::InitializeWorkerContext(Context *const context) {
+    context->backoff_ = 0;
+}
+
+AF_FORCEINLINE void NonBlockingMonitor::ResetYield(Context *const context) {
+    context->backoff_ = 0;
+}
+
+AF_FORCEINLINE bool NonBlockingMonitor::Pulse() {
+    return false;
+}
+
+AF_FORCEINLINE uint32_t NonBlockingMonitor::Waiting() const {
+    return 0;
+}
+
+AF_FORCEINLINE void NonBlockingMonitor::PulseAll() {
+}
+
+AF_FORCEINLINE void NonBlockingMonitor::Wait(Context *const context, LockType &lock) {
+    lock.Unlock();
+    Utils::Backoff(context->backoff_);
+    lock.Relock();
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_SCHEDULER_NONBLOCKINGMONITOR_H
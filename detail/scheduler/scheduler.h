@@ -47,7 +47,8 @@ public:
         Directory<Mailbox> *const mailboxes,
         FallbackHandlerCollection *const fallback_handlers,
         AllocatorInterface *const message_allocator,
-        MailboxContext *const shared_mailbox_context);
+        MailboxContext *const shared_mailbox_context,
+        const uint32_t throughput);
 
     inline virtual ~Scheduler();
 
@@ -59,19 +60,37 @@ public:
     inline virtual void Release();
 
     /*
-     * Notifies the scheduler that a worker thread is about to start executing a message handler.
+     * Schedules for processing a mailbox that has received a message.
      */
-    inline virtual void BeginHandler(MailboxContext *const mailbox_context, MessageHandlerInterface *const message_handler);
+    inline virtual void Schedule(MailboxContext *const mailbox_context, Mailbox *const mailbox);
 
     /*
-     * Notifies the scheduler that a worker thread has finished executing a message handler.
+     * Schedules for processing several mailboxes that have received the same message.
      */
-    inline virtual void EndHandler(MailboxContext *const mailbox_context, MessageHandlerInterface *const message_handler);
+    inline virtual void ScheduleBatch(
+        MailboxContext *const mailbox_context,
+        Mailbox *const *const mailboxes,
+        const uint32_t count);
 
     /*
-     * Schedules for processing a mailbox that has received a message.
+     * Requeues a mailbox that has spent its throughput budget with messages still queued.
      */
-    inline virtual void Schedule(MailboxContext *const mailbox_context, Mailbox *const mailbox);
+    inline virtual void Requeue(MailboxContext *const mailbox_context, Mailbox *const mailbox);
+
+    /*
+     * Frees the directory index of a retired mailbox that has been emptied and released.
+     */
+    inline virtual void ReleaseMailbox(Mailbox *const mailbox);
+
+    /*
+     * Blocks the calling thread until credit may have been returned to a flow-controlled mailbox.
+     */
+    inline virtual void WaitForCredit(Mailbox *const mailbox);
+
+    /*
+     * Wakes threads blocked waiting for credit.
+     */
+    inline virtual void SignalCredit();
 
     inline virtual void SetMaxThreads(const uint32_t count);
     inline virtual void SetMinThreads(const uint32_t count);
@@ -79,6 +98,7 @@ public:
     inline virtual uint32_t GetMinThreads() const;
     inline virtual uint32_t GetNumThreads() const;
     inline virtual uint32_t GetPeakThreads() const;
+    inline virtual void IncrementCounter(MailboxContext *const mailbox_context, const uint32_t counter);
     inline virtual void ResetCounters();
     inline virtual uint32_t GetCounterValue(const uint32_t counter) const;
 
@@ -117,6 +137,7 @@ private:
     FallbackHandlerCollection *fallback_handlers_;      // Pointer to external fallback message handler collection.
     AllocatorInterface *message_allocator_;             // Pointer to external message memory block allocator.
     MailboxContext *shared_mailbox_context_;            // Pointer to external mailbox context shared by all worker threads.
+    uint32_t throughput_;                               // Maximum number of messages processed per mailbox activation.
 
     QueueContext shared_queue_context_;                 // Per-framework queue context shared by all worker threads.
     QueueType queue_;                                   // Instantiation of the work queue implementation.
@@ -129,6 +150,8 @@ private:
     Atomic::UInt32 thread_count_;                       // Actual number of worker threads.
     ContextList thread_contexts_;                       // List of worker thread context objects.
     mutable Mutex thread_context_lock_;                 // Protects the thread context list.
+
+    Condition credit_condition_;                        // Signalled when blocked senders may have credit.
 };
 
 
@@ -137,11 +160,13 @@ inline Scheduler<QueueType>::Scheduler(
     Directory<Mailbox> *const mailboxes,
     FallbackHandlerCollection *const fallback_handlers,
     AllocatorInterface *const message_allocator,
-    MailboxContext *const shared_mailbox_context)
+    MailboxContext *const shared_mailbox_context,
+    const uint32_t throughput)
   : mailboxes_(mailboxes),
     fallback_handlers_(fallback_handlers),
     message_allocator_(message_allocator),
     shared_mailbox_context_(shared_mailbox_context),
+    throughput_(throughput),
     shared_queue_context_(),
     queue_(),
     manager_thread_(),
@@ -150,7 +175,8 @@ inline Scheduler<QueueType>::Scheduler(
     peak_thread_count_(0),
     thread_count_(0),
     thread_contexts_(),
-    thread_context_lock_() {
+    thread_context_lock_(),
+    credit_condition_() {
 }
 
 template <class QueueType>
@@ -167,6 +193,7 @@ inline void Scheduler<QueueType>::Initialize(const uint32_t thread_count) {
     shared_mailbox_context_->fallback_handlers_ = fallback_handlers_;
     shared_mailbox_context_->scheduler_ = this;
     shared_mailbox_context_->queue_context_ = &shared_queue_context_;
+    shared_mailbox_context_->throughput_ = throughput_;
 
     queue_.InitializeSharedContext(&shared_queue_context_);
 
@@ -211,21 +238,6 @@ inline void Scheduler<QueueType>::Release() {
     queue_.ReleaseSharedContext(&shared_queue_context_);
 }
 
-template <class QueueType>
-inline void Scheduler<QueueType>::BeginHandler(MailboxContext *const mailbox_context, MessageHandlerInterface *const message_handler) {
-    // Store the last send count for this handler in the context so it's available to the scheduler.
-    // Reset the message send count in the context and start counting sends for this handler.
-    mailbox_context->predicted_send_count_ = message_handler->GetPredictedSendCount();
-    mailbox_context->send_count_ = 0;
-}
-
-template <class QueueType>
-inline void Scheduler<QueueType>::EndHandler(MailboxContext *const mailbox_context, MessageHandlerInterface *const message_handler) {
-    // Update the cached message send count for this handler.
-    // These counts are used to predict which of a handler's message sends will be its last.
-    message_handler->ReportSendCount(mailbox_context->send_count_);
-}
-
 template <class QueueType>
 inline void Scheduler<QueueType>::Schedule(MailboxContext *const mailbox_context, Mailbox *const mailbox) {
     QueueContext *const queue_context(reinterpret_cast<QueueContext *>(mailbox_context->queue_context_));
@@ -251,6 +263,10 @@ inline void Scheduler<QueueType>::Schedule(MailboxContext *const mailbox_context
         hints.message_count_ = sending_mailbox->Count();
     }
 
+    // Whether the mailbox should be scheduled ahead of mailboxes holding only normal messages.
+    hints.high_priority_ = mailbox->HasHighPriority();
+    hints.yield_ = false;
+
     queue_.Push(queue_context, mailbox, hints);
 
     // We remember the number of messages each message handler sends, so we can
@@ -258,6 +274,75 @@ inline void Scheduler<QueueType>::Schedule(MailboxContext *const mailbox_context
     ++mailbox_context->send_count_;
 }
 
+template <class QueueType>
+inline void Scheduler<QueueType>::ScheduleBatch(
+    MailboxContext *const mailbox_context,
+    Mailbox *const *const mailboxes,
+    const uint32_t count) {
+    QueueContext *const queue_context(reinterpret_cast<QueueContext *>(mailbox_context->queue_context_));
+    Mailbox *const sending_mailbox(mailbox_context->mailbox_);
+
+    // The hints describe the last mailbox in the batch, which may be the handler's last send.
+    SchedulerHints hints;
+    hints.send_ = true;
+    hints.predicted_send_count_ = mailbox_context->predicted_send_count_;
+    hints.send_index_ = mailbox_context->send_count_ + count - 1;
+    hints.message_count_ = 0;
+    if (sending_mailbox) {
+        hints.message_count_ = sending_mailbox->Count();
+    }
+
+    // Queues check the priority of each mailbox in the batch for themselves.
+    hints.high_priority_ = mailboxes[count - 1]->HasHighPriority();
+    hints.yield_ = false;
+
+    queue_.PushBatch(queue_context, mailboxes, count, hints);
+
+    mailbox_context->send_count_ += count;
+}
+
+template <class QueueType>
+inline void Scheduler<QueueType>::Requeue(MailboxContext *const mailbox_context, Mailbox *const mailbox) {
+    QueueContext *const queue_context(reinterpret_cast<QueueContext *>(mailbox_context->queue_context_));
+
+    // The yield hint keeps the mailbox out of the local queue, which is popped first,
+    // and any other queue private to the worker thread.
+    SchedulerHints hints;
+    hints.send_ = false;
+    hints.predicted_send_count_ = 0;
+    hints.send_index_ = 0;
+    hints.message_count_ = mailbox->Count();
+    hints.high_priority_ = mailbox->HasHighPriority();
+    hints.yield_ = true;
+
+    queue_.Push(queue_context, mailbox, hints);
+}
+
+template <class QueueType>
+inline void Scheduler<QueueType>::ReleaseMailbox(Mailbox *const mailbox) {
+    mailboxes_->Free(mailbox->GetIndex());
+}
+
+template <class QueueType>
+inline void Scheduler<QueueType>::WaitForCredit(Mailbox *const mailbox) {
+    // Credit is returned before it's signalled, and signalling takes the lock, so checking
+    // under the lock ensures we either see the credit or are waiting when it's signalled.
+    Lock lock(credit_condition_.GetMutex());
+    if (!mailbox->HasCredit() && !mailbox->IsRetired()) {
+        credit_condition_.Wait(lock);
+    }
+}
+
+template <class QueueType>
+inline void Scheduler<QueueType>::SignalCredit() {
+    // Acquiring the lock ensures any thread that missed the credit is now waiting.
+    {
+        Lock lock(credit_condition_.GetMutex());
+    }
+
+    credit_condition_.PulseAll();
+}
+
 template <class QueueType>
 inline void Scheduler<QueueType>::SetMaxThreads(const uint32_t count) {
     if (target_thread_count_.Load() > count) {
@@ -318,6 +403,12 @@ inline bool Scheduler<QueueType>::QueuesEmpty() const {
     return empty;
 }
 
+template <class QueueType>
+inline void Scheduler<QueueType>::IncrementCounter(MailboxContext *const mailbox_context, const uint32_t counter) {
+    QueueContext *const queue_context(reinterpret_cast<QueueContext *>(mailbox_context->queue_context_));
+    queue_.IncrementCounter(queue_context, counter);
+}
+
 template <class QueueType>
 inline void Scheduler<QueueType>::ResetCounters() {
     // Reset the counters in the shared thread context.
@@ -428,11 +519,12 @@ inline void Scheduler<QueueType>::ManagerThreadProc() {
             // Set up the mailbox context for the worker thread.
             // The mailbox context holds pointers to the scheduler and queue context.
             // These are used to push mailboxes that still need further processing.
-            thread_context->user_context_.message_cache_.SetAllocator(message_allocator_);
-            thread_context->user_context_.mailbox_context_.message_allocator_ = &thread_context->user_context_.message_cache_;
+            thread_context->user_context_.message_heap_ = MessageHeap::Create(false);
+            thread_context->user_context_.mailbox_context_.message_allocator_ = thread_context->user_context_.message_heap_;
             thread_context->user_context_.mailbox_context_.fallback_handlers_ = fallback_handlers_;
             thread_context->user_context_.mailbox_context_.scheduler_ = this;
             thread_context->user_context_.mailbox_context_.queue_context_ = &thread_context->queue_context_;
+            thread_context->user_context_.mailbox_context_.throughput_ = throughput_;
 
             // Create a worker thread with the created context.
             if (!ThreadPool::CreateThread(thread_context)) {
@@ -485,6 +577,10 @@ inline void Scheduler<QueueType>::ManagerThreadProc() {
         // Wait for the thread to stop and then destroy it.
         ThreadPool::DestroyThread(thread_context);
 
+        // Give up the thread's message heap. Messages it allocated may still be in flight
+        // to other frameworks, in which case the heap is destroyed when they're freed.
+        thread_context->user_context_.message_heap_->Release();
+
         // Destruct and free the per-thread context.
         thread_context->~ThreadContext();
         allocator->FreeWithSize(thread_context, sizeof(ThreadContext));
@@ -23,6 +23,8 @@ public:
     uint32_t predicted_send_count_;     // Predicts the number of messages that will be sent by the current handler.
     uint32_t send_index_;               // Index of this message send within the current handler.
     uint32_t message_count_;            // Number of messages queued in the mailbox that is currently being processed.
+    bool high_priority_;                // Indicates whether the mailbox holds high-priority messages.
+    bool yield_;                        // Indicates whether the mailbox is yielding after spending its throughput budget.
 
 private:
     SchedulerHints(const SchedulerHints &other);
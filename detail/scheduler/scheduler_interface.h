@@ -8,8 +8,6 @@
 
 #include "AF/detail/directory/directory.h"
 
-#include "AF/detail/handlers/message_handler_interface.h"
-
 #include "AF/detail/mailboxes/mailbox.h"
 
 
@@ -49,19 +47,39 @@ public:
     virtual void Release() = 0;
 
     /*
-     * Notifies the scheduler that a worker thread is about to start executing a message handler.
+     * Schedules for processing a mailbox that has received a message.
      */
-    virtual void BeginHandler(MailboxContext *const mailbox_context, MessageHandlerInterface *const message_handler) = 0;
+    virtual void Schedule(MailboxContext *const mailbox_context, Mailbox *const mailbox) = 0;
 
     /*
-     * Notifies the scheduler that a worker thread has finished executing a message handler.
+     * Schedules for processing several mailboxes that have received the same message.
      */
-    virtual void EndHandler(MailboxContext *const mailbox_context, MessageHandlerInterface *const message_handler) = 0;
+    virtual void ScheduleBatch(
+        MailboxContext *const mailbox_context,
+        Mailbox *const *const mailboxes,
+        const uint32_t count) = 0;
 
     /*
-     * Schedules for processing a mailbox that has received a message.
+     * Requeues a mailbox that has spent its throughput budget with messages still queued.
+     * The mailbox goes behind the mailboxes already waiting, so other actors get a turn.
      */
-    virtual void Schedule(MailboxContext *const mailbox_context, Mailbox *const mailbox) = 0;
+    virtual void Requeue(MailboxContext *const mailbox_context, Mailbox *const mailbox) = 0;
+
+    /*
+     * Frees the directory index of a retired mailbox that has been emptied and released.
+     */
+    virtual void ReleaseMailbox(Mailbox *const mailbox) = 0;
+
+    /*
+     * Blocks the calling thread until credit may have been returned to a flow-controlled mailbox,
+     * or its actor deregistered. Callers should recheck the mailbox, and may be woken spuriously.
+     */
+    virtual void WaitForCredit(Mailbox *const mailbox) = 0;
+
+    /*
+     * Wakes threads blocked in WaitForCredit.
+     */
+    virtual void SignalCredit() = 0;
 
     /*
      * Sets a maximum limit on the number of worker threads enabled in the scheduler.
@@ -93,6 +111,11 @@ public:
      */
     virtual uint32_t GetPeakThreads() const = 0;
 
+    /*
+     * Increments an event counter, for the worker thread owning the given mailbox context.
+     */
+    virtual void IncrementCounter(MailboxContext *const mailbox_context, const uint32_t counter) = 0;
+
     /*
      * Resets all the scheduler's internal event counters to zero.
      */
@@ -19,6 +19,38 @@ namespace AF
 namespace Detail
 {
 
+/*
+ * Marks the worker threads of every framework's thread pool, so code that may run
+ * on any thread can tell whether it's holding up a worker.
+ */
+class WorkerThread {
+public:
+    /*
+     * Returns true if the calling thread is a worker thread of any framework.
+     */
+    AF_FORCEINLINE static bool IsCurrent() {
+        return Flag();
+    }
+
+    /*
+     * Marks the calling thread as a worker thread for the rest of its life.
+     */
+    AF_FORCEINLINE static void MarkCurrent() {
+        Flag() = true;
+    }
+
+private:
+    WorkerThread();
+    WorkerThread(const WorkerThread &other);
+    WorkerThread &operator=(const WorkerThread &other);
+
+    // Returns the calling thread's flag. Inline functions share one static across all units.
+    inline static bool &Flag() {
+        static thread_local bool worker(false);
+        return worker;
+    }
+};
+
 /*
  * A pool of worker threads that process a queue of work mailboxes.
  */
@@ -74,6 +106,7 @@ public:
 
     /*
      * Waits for the given thread, which must have been stopped with StopThread, to terminate.
+     * Any mailboxes the thread left queued for itself are then handed to the remaining threads.
      */
     inline static bool JoinThread(ThreadContext *const thread_context);
 
@@ -159,6 +192,9 @@ inline bool ThreadPool<QueueType, ContextType, ProcessorType>::JoinThread(Thread
     // Wait for the thread to finish.
     thread_context->thread_->Join();
 
+    // Mailboxes the thread queued for itself before it stopped would otherwise be stranded.
+    thread_context->queue_->RetireWorkerContext(&thread_context->queue_context_);
+
     return true;
 }
 
@@ -196,6 +232,8 @@ inline void ThreadPool<QueueType, ContextType, ProcessorType>::ThreadEntryPoint(
     QueueContext *const queue_context(&thread_context->queue_context_);
     ContextType *const user_context(&thread_context->user_context_);
 
+    WorkerThread::MarkCurrent();
+
     // Mark the thread as started so the caller knows they can start issuing work.
     thread_context->started_ = true;
 
@@ -0,0 +1,656 @@
+#ifndef AF_DETAIL_SCHEDULER_WORKSTEALINGQUEUE_H
+#define AF_DETAIL_SCHEDULER_WORKSTEALINGQUEUE_H
+
+#include "AF/align.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include "AF/detail/containers/queue.h"
+#include "AF/detail/containers/steal_queue.h"
+
+#include "AF/detail/mailboxes/mailbox.h"
+
+#include "AF/detail/scheduler/counting.h"
+
+#include "AF/detail/threading/atomic.h"
+#include "AF/detail/threading/clock.h"
+
+#include "AF/detail/scheduler/scheduler_hints.h"
+
+#include "AF/detail/utils/utils.h"
+
+#include <atomic>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * Work-stealing mailbox queue implementation.
+ *
+ * Each worker thread owns a bounded lock-free queue of scheduled mailboxes, in addition to
+ * the single-item local queue used for tail sends. Mailboxes scheduled by a worker thread
+ * are pushed to its own queue without taking any lock, and idle workers steal from the
+ * queues of their peers. The locked shared queue is only used for mailboxes scheduled
+ * from outside the worker threads, and for overflow when a worker's own queue is full.
+ *
+ * Workers only block on the monitor when every queue is empty. Pushers check an atomic
+ * count of idle workers and only touch the monitor when some worker may be waiting.
+ *
+ * Mailboxes holding high-priority messages are never pushed to the owned queues. They go
+ * to a separate locked queue, which workers drain before any of their other queues.
+ */
+template <class MonitorType>
+class WorkStealingQueue {
+public:
+    // The item type which is queued by the queue.
+    typedef Mailbox ItemType;
+
+    // Context structure used to access the queue.
+    class ContextType {
+    public:
+        friend class WorkStealingQueue;
+
+        inline ContextType()
+          : running_(false),
+            shared_(false),
+            registered_(false),
+            steal_index_(0),
+            local_work_queue_(0),
+            owned_work_queue_() {
+        }
+
+    private:
+        template <class ValueType>
+        struct AF_PREALIGN(AF_CACHELINE_ALIGNMENT) Aligned {
+            ValueType value_;
+
+        } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
+
+        bool running_;                                      // Used to signal the thread to terminate.
+        bool shared_;                                       // Indicates whether this is the 'shared' context.
+        bool registered_;                                   // Indicates whether the owned queue is visible to thieves.
+        uint32_t steal_index_;                              // Index of the next peer to try stealing from.
+        Mailbox *local_work_queue_;                         // Local thread-specific single-item work queue.
+        StealQueue<Mailbox, 256> owned_work_queue_;         // Work queue owned by this thread and stolen from by others.
+        typename MonitorType::Context monitor_context_;     // Per-thread monitor primitive context.
+        Aligned<Atomic::UInt32> counters_[MAX_COUNTERS];    // Array of per-context event counters.
+    };
+
+    inline explicit WorkStealingQueue();
+
+    // Initializes a user-allocated context as the 'shared' context common to all threads.
+    inline void InitializeSharedContext(ContextType *const context);
+
+    // Initializes a user-allocated context as the context associated with the calling thread.
+    inline void InitializeWorkerContext(ContextType *const context);
+
+    // Releases a previously initialized shared context.
+    inline void ReleaseSharedContext(ContextType *const context);
+
+    // Releases a previously initialized worker thread context.
+    inline void ReleaseWorkerContext(ContextType *const context);
+
+    // Hands the mailboxes queued in a released worker context to the remaining threads,
+    // once the thread that owned the context has terminated.
+    inline void RetireWorkerContext(ContextType *const context);
+
+    // Resets to zero the given counter for the given thread context.
+    inline void ResetCounter(ContextType *const context, const uint32_t counter) const;
+
+    // Increments the given counter for the given thread context.
+    inline void IncrementCounter(ContextType *const context, const uint32_t counter) const;
+
+    // Gets the value of the given counter for the given thread context.
+    inline uint32_t GetCounterValue(const ContextType *const context, const uint32_t counter) const;
+
+    // Accumulates the value of the given counter for the given thread context.
+    inline void AccumulateCounterValue(
+        const ContextType *const context,
+        const uint32_t counter,
+        uint32_t &accumulator) const;
+
+    // Returns true if a call to Pop would return no mailbox, for the given context.
+    inline bool Empty(const ContextType *const context) const;
+
+    // Returns true if the thread with the given context is still enabled.
+    inline bool Running(const ContextType *const context) const;
+
+    // Wakes any worker threads which are blocked waiting for the queue to become non-empty.
+    inline void WakeAll();
+
+    // Pushes a mailbox into the queue, scheduling it for processing.
+    inline void Push(ContextType *const context, Mailbox *mailbox, const SchedulerHints &hints);
+
+    // Pushes several mailboxes into the queue at once, scheduling them all for processing.
+    // The hints describe the last mailbox, which may be pushed to the local queue as in Push.
+    inline void PushBatch(
+        ContextType *const context,
+        Mailbox *const *const mailboxes,
+        const uint32_t count,
+        const SchedulerHints &hints);
+
+    // Pops a previously pushed mailbox from the queue for processing.
+    inline Mailbox *Pop(ContextType *const context);
+
+private:
+    // Maximum number of worker threads whose owned queues can be stolen from.
+    // Workers beyond this limit fall back to pushing to the shared queue.
+    static const uint32_t MAX_WORKERS = 64;
+
+    WorkStealingQueue(const WorkStealingQueue &other);
+    WorkStealingQueue &operator=(const WorkStealingQueue &other);
+
+    inline static bool PreferLocalQueue(
+        const ContextType *const context,
+        const SchedulerHints &hints);
+
+    // Pushes a mailbox to the shared queue and wakes a waiting worker.
+    inline void PushShared(ContextType *const context, Mailbox *const mailbox);
+
+    // Pushes a mailbox onto the shared or high-priority queue. The lock must be held.
+    inline void EnqueueShared(ContextType *const context, Mailbox *const mailbox);
+
+    // Pops a mailbox from the high-priority queue, or else the shared queue. The lock must be held.
+    inline Mailbox *DequeueShared();
+
+    // Tries to take a mailbox from the owned queues of the given worker and its peers.
+    inline Mailbox *Steal(ContextType *const context);
+
+    mutable MonitorType monitor_;                       // Synchronizes access to the shared queue.
+    Queue<Mailbox> shared_work_queue_;                  // Work queue shared by all the threads in a scheduler.
+    Queue<Mailbox> high_work_queue_;                    // Shared work queue of mailboxes holding high-priority messages.
+    std::atomic<uint32_t> high_count_;                  // Size of the high-priority queue, read without locking.
+    std::atomic<uint32_t> idle_count_;                  // Number of workers that may be waiting on the monitor.
+    std::atomic<uint32_t> worker_count_;                // Number of registered worker contexts.
+    std::atomic<ContextType *> workers_[MAX_WORKERS];   // Registered worker contexts, for stealing.
+};
+
+
+template <class MonitorType>
+inline WorkStealingQueue<MonitorType>::WorkStealingQueue()
+  : monitor_(),
+    shared_work_queue_(),
+    high_work_queue_(),
+    high_count_(0),
+    idle_count_(0),
+    worker_count_(0) {
+    for (uint32_t index = 0; index < MAX_WORKERS; ++index) {
+        workers_[index].store(0, std::memory_order_relaxed);
+    }
+}
+
+template <class MonitorType>
+inline void WorkStealingQueue<MonitorType>::InitializeSharedContext(ContextType *const context) {
+    context->shared_ = true;
+}
+
+template <class MonitorType>
+inline void WorkStealingQueue<MonitorType>::InitializeWorkerContext(ContextType *const context) {
+    // Only worker threads should call this method.
+    context->shared_ = false;
+    context->running_ = true;
+
+    // Contexts are reused when stopped threads are restarted, and are never destroyed while
+    // the queue is alive, so each context is registered for stealing at most once.
+    // Contexts are initialized by the scheduler's manager thread only, so no lock is needed.
+    if (!context->registered_) {
+        const uint32_t index(worker_count_.load(std::memory_order_relaxed));
+        if (index < MAX_WORKERS) {
+            workers_[index].store(context, std::memory_order_relaxed);
+            worker_count_.store(index + 1, std::memory_order_release);
+
+            context->steal_index_ = index;
+            context->registered_ = true;
+        }
+    }
+
+    monitor_.InitializeWorkerContext(&context->monitor_context_);
+
+    // The minimum counters need to be initialized to maxint.
+    Counting::Reset(context->counters_[COUNTER_QUEUE_LATENCY_LOCAL_MIN].value_, COUNTER_QUEUE_LATENCY_LOCAL_MIN);
+    Counting::Reset(context->counters_[COUNTER_QUEUE_LATENCY_SHARED_MIN].value_, COUNTER_QUEUE_LATENCY_SHARED_MIN);
+}
+
+template <class MonitorType>
+inline void WorkStealingQueue<MonitorType>::ReleaseSharedContext(ContextType *const /*context*/) {
+}
+
+template <class MonitorType>
+inline void WorkStealingQueue<MonitorType>::ReleaseWorkerContext(ContextType *const context) {
+    // The thread may still be processing a mailbox, so its queues are retired once it's gone.
+    typename MonitorType::LockType lock(monitor_);
+    context->running_ = false;
+}
+
+template <class MonitorType>
+inline void WorkStealingQueue<MonitorType>::RetireWorkerContext(ContextType *const context) {
+    AF_ASSERT(context->running_ == false);
+
+    bool moved(false);
+
+    // With its owner gone nothing more is pushed to the owned queue,
+    // but thieves may still be taking from it, so we take from it like them.
+    {
+        typename MonitorType::LockType lock(monitor_);
+
+        if (Mailbox *const mailbox = context->local_work_queue_) {
+            context->local_work_queue_ = 0;
+            EnqueueShared(context, mailbox);
+            moved = true;
+        }
+
+        while (Mailbox *const mailbox = context->owned_work_queue_.Steal()) {
+            EnqueueShared(context, mailbox);
+            moved = true;
+        }
+    }
+
+    if (moved) {
+        monitor_.PulseAll();
+    }
+}
+
+template <class MonitorType>
+inline void WorkStealingQueue<MonitorType>::ResetCounter(ContextType *const context, const uint32_t counter) const {
+    Counting::Reset(context->counters_[counter].value_, counter);
+}
+
+template <class MonitorType>
+AF_FORCEINLINE void WorkStealingQueue<MonitorType>::IncrementCounter(ContextType *const context, const uint32_t counter) const {
+    Counting::Increment(context->counters_[counter].value_);
+}
+
+template <class MonitorType>
+AF_FORCEINLINE uint32_t WorkStealingQueue<MonitorType>::GetCounterValue(const ContextType *const context, const uint32_t counter) const {
+    return Counting::Get(context->counters_[counter].value_);
+}
+
+template <class MonitorType>
+AF_FORCEINLINE void WorkStealingQueue<MonitorType>::AccumulateCounterValue(
+    const ContextType *const context,
+    const uint32_t counter,
+    uint32_t &accumulator) const {
+    Counting::Accumulate(context->counters_[counter].value_, counter, accumulator);
+}
+
+template <class MonitorType>
+AF_FORCEINLINE bool WorkStealingQueue<MonitorType>::Empty(const ContextType *const context) const {
+    // Check the context's local and owned queues.
+    // If the provided context is the shared context then it doesn't have them.
+    if (!context->shared_) {
+        if (context->local_work_queue_ || !context->owned_work_queue_.Empty()) {
+            return false;
+        }
+    }
+
+    // Check the shared work queues.
+    typename MonitorType::LockType lock(monitor_);
+    return shared_work_queue_.Empty() && high_work_queue_.Empty();
+}
+
+template <class MonitorType>
+AF_FORCEINLINE bool WorkStealingQueue<MonitorType>::Running(const ContextType *const context) const {
+    return context->running_;
+}
+
+template <class MonitorType>
+AF_FORCEINLINE void WorkStealingQueue<MonitorType>::WakeAll() {
+    monitor_.PulseAll();
+}
+
+template <class MonitorType>
+AF_FORCEINLINE void WorkStealingQueue<MonitorType>::Push(
+    ContextType *const context,
+    Mailbox *mailbox,
+    const SchedulerHints &hints) {
+#if AF_ENABLE_COUNTERS
+
+    // Timestamp the mailbox on entry.
+    mailbox->Timestamp() = Clock::GetTicks();
+
+#endif // AF_ENABLE_COUNTERS
+
+    // Update the maximum mailbox queue length seen by this thread.
+    Counting::Raise(context->counters_[COUNTER_MAILBOX_QUEUE_MAX].value_, mailbox->Count());
+
+    // Mailboxes scheduled outside the worker threads go to the shared queue, as do mailboxes
+    // yielding after spending their budget, since the owned queue is taken ahead of it.
+    if (context->shared_ || hints.yield_) {
+        PushShared(context, mailbox);
+        return;
+    }
+
+    // Push the last mailbox messaged by a handler to the local queue, promoting any
+    // mailbox already in the local queue, exactly as in the non-stealing queue.
+    if (PreferLocalQueue(context, hints)) {
+        Mailbox *const previous(context->local_work_queue_);
+        context->local_work_queue_ = mailbox;
+
+        Counting::Increment(context->counters_[COUNTER_LOCAL_PUSHES].value_);
+
+        if (previous == 0) {
+            return;
+        }
+
+        mailbox = previous;
+    }
+
+    // Push the mailbox to the calling thread's owned queue, where idle peers can steal it.
+    // If the owned queue is full, or isn't registered, spill to the shared queue.
+    // Mailboxes holding high-priority messages always go to the high-priority queue.
+    if (!context->registered_ || mailbox->HasHighPriority() || !context->owned_work_queue_.Push(mailbox)) {
+        PushShared(context, mailbox);
+        return;
+    }
+
+    Counting::Increment(context->counters_[COUNTER_SHARED_PUSHES].value_);
+
+    // Pair with the fence in Pop: either a waiting worker sees the pushed mailbox when it
+    // re-checks the queues, or we see that it's waiting and wake it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_count_.load(std::memory_order_relaxed) > 0) {
+        // Acquiring the lock ensures any worker that counted itself idle is now waiting.
+        {
+            typename MonitorType::LockType lock(monitor_);
+        }
+
+        if (monitor_.Pulse()) {
+            return;
+        }
+    }
+
+    Counting::Increment(context->counters_[COUNTER_WAKEUPS_AVOIDED].value_);
+}
+
+template <class MonitorType>
+inline void WorkStealingQueue<MonitorType>::PushBatch(
+    ContextType *const context,
+    Mailbox *const *const mailboxes,
+    const uint32_t count,
+    const SchedulerHints &hints) {
+    for (uint32_t index = 0; index < count; ++index) {
+#if AF_ENABLE_COUNTERS
+
+        // Timestamp the mailbox on entry.
+        mailboxes[index]->Timestamp() = Clock::GetTicks();
+
+#endif // AF_ENABLE_COUNTERS
+
+        Counting::Raise(context->counters_[COUNTER_MAILBOX_QUEUE_MAX].value_, mailboxes[index]->Count());
+    }
+
+    // Only the last mailbox in the batch can be the handler's last send, so only it can
+    // go to the local queue. A mailbox it displaces from there is pushed with the others.
+    uint32_t push_count(count);
+    Mailbox *promoted(0);
+
+    if (PreferLocalQueue(context, hints)) {
+        --push_count;
+        promoted = context->local_work_queue_;
+        context->local_work_queue_ = mailboxes[push_count];
+
+        Counting::Increment(context->counters_[COUNTER_LOCAL_PUSHES].value_);
+    }
+
+    const uint32_t total(promoted ? push_count + 1 : push_count);
+    if (total == 0) {
+        return;
+    }
+
+    // Push to the owned queue until it's full, then push the rest to the shared queue together.
+    // The displaced mailbox, which was scheduled earlier, goes first. The first mailbox holding
+    // high-priority messages also ends the run, since it has to go to the high-priority queue.
+    uint32_t index(0);
+    if (!context->shared_ && context->registered_) {
+        while (index < total) {
+            Mailbox *const mailbox(promoted ? (index == 0 ? promoted : mailboxes[index - 1]) : mailboxes[index]);
+            if (mailbox->HasHighPriority() || !context->owned_work_queue_.Push(mailbox)) {
+                break;
+            }
+
+            ++index;
+        }
+    }
+
+    const bool spilled(index < total);
+    uint32_t waiting(0);
+    if (spilled) {
+        typename MonitorType::LockType lock(monitor_);
+
+        for (; index < total; ++index) {
+            Mailbox *const mailbox(promoted ? (index == 0 ? promoted : mailboxes[index - 1]) : mailboxes[index]);
+            EnqueueShared(context, mailbox);
+        }
+
+        waiting = monitor_.Waiting();
+    }
+
+    // A single check of the idle count covers the whole batch; see Push.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    uint32_t woken(0);
+    if (spilled || idle_count_.load(std::memory_order_relaxed) > 0) {
+        // Acquiring the lock ensures any worker that counted itself idle is now waiting.
+        if (!spilled) {
+            typename MonitorType::LockType lock(monitor_);
+            waiting = monitor_.Waiting();
+        }
+
+        // Wake a worker thread per mailbox, but no more than were waiting. The first pulse is
+        // always sent, since it also alerts spinning threads, which aren't counted as waiting.
+        const uint32_t wake(waiting < total ? (waiting ? waiting : 1) : total);
+        while (woken < wake && monitor_.Pulse()) {
+            ++woken;
+        }
+    }
+
+    for (index = 0; index < total; ++index) {
+        if (index >= woken) {
+            Counting::Increment(context->counters_[COUNTER_WAKEUPS_AVOIDED].value_);
+        }
+
+        Counting::Increment(context->counters_[COUNTER_SHARED_PUSHES].value_);
+    }
+}
+
+template <class MonitorType>
+AF_FORCEINLINE Mailbox *WorkStealingQueue<MonitorType>::Pop(ContextType *const context) {
+    Mailbox *mailbox(0);
+    uint32_t counter_offset(0);
+
+    // The shared context is never used to call Pop, only to Push
+    // messages sent outside the context of a worker thread.
+    AF_ASSERT(context->shared_ == false);
+
+    // Mailboxes holding high-priority messages are taken first, even ahead of the local queue.
+    // The count is read without locking, so a mailbox pushed concurrently may be missed here,
+    // in which case it's found in the normal way below.
+    if (high_count_.load(std::memory_order_relaxed) > 0) {
+        typename MonitorType::LockType lock(monitor_);
+        mailbox = DequeueShared();
+        counter_offset = 2;
+    }
+
+    // Try to pop a mailbox off the calling thread's local work queue.
+    // Note that the local queue contains at most one item.
+    if (mailbox == 0 && context->local_work_queue_) {
+        mailbox = context->local_work_queue_;
+        context->local_work_queue_ = 0;
+    } else if (mailbox == 0) {
+        counter_offset = 2;
+
+        // Try the owned queue, then steal from peers, without taking any lock.
+        mailbox = Steal(context);
+        if (mailbox == 0) {
+            // Wait on the shared queue until we pop a mailbox from it or find one to steal.
+            typename MonitorType::LockType lock(monitor_);
+            while (shared_work_queue_.Empty() && high_work_queue_.Empty() && context->running_ == true) {
+                // Count ourselves idle before re-checking the owned queues, so that
+                // a concurrent pusher either sees us idle or we see its mailbox.
+                idle_count_.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                mailbox = Steal(context);
+                if (mailbox) {
+                    idle_count_.fetch_sub(1, std::memory_order_relaxed);
+                    break;
+                }
+
+                Counting::Increment(context->counters_[COUNTER_YIELDS].value_);
+                monitor_.Wait(&context->monitor_context_, lock);
+
+                idle_count_.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            if (mailbox == 0) {
+                mailbox = DequeueShared();
+            }
+        }
+
+        if (mailbox) {
+            monitor_.ResetYield(&context->monitor_context_);
+        }
+    }
+
+    if (mailbox) {
+        Counting::Increment(context->counters_[COUNTER_MESSAGES_PROCESSED].value_);
+
+#if AF_ENABLE_COUNTERS
+
+        // Compute the latency and update the maximum queue latency seen by this thread.
+        const uint64_t timestamp(Clock::GetTicks());
+        const uint64_t ticks(timestamp - mailbox->Timestamp());
+        const uint64_t ticks_per_second(Clock::GetFrequency());
+        const uint64_t usec(ticks * 1000000 / ticks_per_second);
+
+        Atomic::UInt32 &max_counter(context->counters_[COUNTER_QUEUE_LATENCY_LOCAL_MAX + counter_offset].value_);
+        Atomic::UInt32 &min_counter(context->counters_[COUNTER_QUEUE_LATENCY_LOCAL_MIN + counter_offset].value_);
+
+        Counting::Raise(max_counter, static_cast<uint32_t>(usec));
+        Counting::Lower(min_counter, static_cast<uint32_t>(usec));
+
+#endif // AF_ENABLE_COUNTERS
+
+    }
+
+    return mailbox;
+}
+
+template <class MonitorType>
+AF_FORCEINLINE bool WorkStealingQueue<MonitorType>::PreferLocalQueue(
+    const ContextType *const context,
+    const SchedulerHints &hints) {
+    // The shared context doesn't have (or doesn't use) a local queue.
+    if (context->shared_) {
+        return false;
+    }
+
+    // Mailboxes yielding after spending their budget go behind the others waiting,
+    // rather than to the local queue, which would hand them straight back.
+    if (hints.yield_) {
+        return false;
+    }
+
+    // Mailboxes holding high-priority messages go to the high-priority queue.
+    if (hints.high_priority_) {
+        return false;
+    }
+
+    if (hints.send_) {
+        // If this send isn't predicted to be the last then push it to the owned queue.
+        if (hints.send_index_ + 1 < hints.predicted_send_count_) {
+            return false;
+        }
+
+        // If the sending mailbox still has unprocessed messages then it will
+        // be pushed to the local queue, so push this mailbox to the owned queue.
+        if (hints.message_count_ > 1) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <class MonitorType>
+AF_FORCEINLINE void WorkStealingQueue<MonitorType>::PushShared(ContextType *const context, Mailbox *const mailbox) {
+    // Because the shared queue is accessed by multiple threads we have to protect it.
+    {
+        typename MonitorType::LockType lock(monitor_);
+        EnqueueShared(context, mailbox);
+    }
+
+    // Pulse the condition associated with the shared queue to wake a worker thread.
+    // It's okay to release the lock before calling Pulse.
+    // The monitor only signals if a worker thread is actually waiting.
+    if (!monitor_.Pulse()) {
+        Counting::Increment(context->counters_[COUNTER_WAKEUPS_AVOIDED].value_);
+    }
+
+    Counting::Increment(context->counters_[COUNTER_SHARED_PUSHES].value_);
+}
+
+template <class MonitorType>
+AF_FORCEINLINE void WorkStealingQueue<MonitorType>::EnqueueShared(ContextType *const context, Mailbox *const mailbox) {
+    if (mailbox->HasHighPriority()) {
+        high_work_queue_.Push(mailbox);
+        high_count_.fetch_add(1, std::memory_order_relaxed);
+
+        Counting::Increment(context->counters_[COUNTER_HIGH_PRIORITY_PUSHES].value_);
+        return;
+    }
+
+    shared_work_queue_.Push(mailbox);
+}
+
+template <class MonitorType>
+AF_FORCEINLINE Mailbox *WorkStealingQueue<MonitorType>::DequeueShared() {
+    if (!high_work_queue_.Empty()) {
+        high_count_.fetch_sub(1, std::memory_order_relaxed);
+        return static_cast<Mailbox *>(high_work_queue_.Pop());
+    }
+
+    if (!shared_work_queue_.Empty()) {
+        return static_cast<Mailbox *>(shared_work_queue_.Pop());
+    }
+
+    return 0;
+}
+
+template <class MonitorType>
+AF_FORCEINLINE Mailbox *WorkStealingQueue<MonitorType>::Steal(ContextType *const context) {
+    // Take from the front of our own queue first, which preserves the scheduling
+    // order of the mailboxes we pushed and keeps them warm in our cache.
+    if (Mailbox *const mailbox = context->owned_work_queue_.Steal()) {
+        return mailbox;
+    }
+
+    // Visit the peers round-robin, starting where we left off last time.
+    const uint32_t worker_count(worker_count_.load(std::memory_order_acquire));
+    for (uint32_t attempt = 0; attempt < worker_count; ++attempt) {
+        if (++context->steal_index_ >= worker_count) {
+            context->steal_index_ = 0;
+        }
+
+        ContextType *const victim(workers_[context->steal_index_].load(std::memory_order_relaxed));
+        if (victim != context) {
+            if (Mailbox *const mailbox = victim->owned_work_queue_.Steal()) {
+                Counting::Increment(context->counters_[COUNTER_STEALS].value_);
+                return mailbox;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_SCHEDULER_WORKSTEALINGQUEUE_H
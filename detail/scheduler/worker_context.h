@@ -2,7 +2,7 @@
 #define AF_DETAIL_SCHEDULER_WORKERCONTEXT_H
 
 
-#include "AF/detail/allocators/caching_allocator.h"
+#include "AF/detail/allocators/message_heap.h"
 #include "AF/detail/scheduler/mailbox_context.h"
 
 
@@ -17,10 +17,10 @@ namespace Detail
  */
 class WorkerContext {
 public:
-    inline WorkerContext() {
+    inline WorkerContext() : message_heap_(0) {
     }
 
-    CachingAllocator<> message_cache_;       // Per-thread cache of message memory blocks.
+    MessageHeap *message_heap_;              // Per-thread heap of message memory blocks.
     MailboxContext mailbox_context_;         // Per-thread context for mailbox processing.
 
 private:
@@ -0,0 +1,208 @@
+#ifndef AF_DETAIL_SCHEDULER_YIELDINGMONITOR_H
+#define AF_DETAIL_SCHEDULER_YIELDINGMONITOR_H
+
+#include "AF/align.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include "AF/detail/threading/atomic.h"
+#include "AF/detail/threading/condition.h"
+#include "AF/detail/threading/lock.h"
+#include "AF/detail/threading/mutex.h"
+#include "AF/detail/threading/waiter_count.h"
+
+#include "AF/detail/utils/utils.h"
+
+#include <atomic>
+#include <thread>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * Hybrid monitor thread synchronization primitive that spins, then yields, then blocks.
+ *
+ * Each call to Wait performs one step of the waiting thread's backoff and returns, so
+ * the caller re-checks its wait condition between steps. Early steps release the lock and
+ * spin with pause instructions until the monitor is pulsed. Later steps yield the processor,
+ * and once the thread has exhausted its budget it blocks on a condition variable.
+ *
+ * The spin budget of each thread adapts to the observed arrival rate of work: it grows when
+ * work arrives after spinning has given up but before the thread blocks, and shrinks when
+ * the thread blocks anyway, so that spinning is only paid for when it's likely to pay off.
+ */
+class YieldingMonitor
+{
+public:
+    struct Context {
+        uint32_t backoff_;              // Number of backoff steps taken since work was last found.
+        uint32_t spin_limit_;           // Adaptive number of spin steps to take before yielding.
+        bool parked_;                   // Whether the thread blocked since work was last found.
+    };
+
+    class LockType {
+    public:
+        friend class YieldingMonitor;
+
+        AF_FORCEINLINE explicit LockType(YieldingMonitor &monitor) 
+          : lock_(monitor.condition_.GetMutex()) {
+        }
+
+        AF_FORCEINLINE void Unlock() {
+            lock_.Unlock();
+        }
+
+        AF_FORCEINLINE void Relock() {
+            lock_.Relock();
+        }
+
+    private:
+        LockType(const LockType &other);
+        LockType &operator=(const LockType &other);
+
+        Lock lock_;
+    };
+
+    friend class LockType;
+
+    inline explicit YieldingMonitor();
+
+    // Initializes the context structure of a worker thread.
+    // The calling thread must be a worker thread.
+    inline void InitializeWorkerContext(Context *const context);
+
+    // Resets the yield backoff following a successful acquire, adapting the spin budget.
+    // The calling thread should not hold a lock.
+    inline void ResetYield(Context *const context);
+
+    // Wakes at most one waiting thread, returning false if no blocked thread was left unsignalled.
+    // The calling thread should hold a lock while changing the protected state 
+    // but should release it before calling Pulse.
+    inline bool Pulse();
+
+    // Gets the number of blocked threads that haven't been pulsed yet.
+    // The calling thread should hold a lock, so that threads about to block are counted.
+    inline uint32_t Waiting() const;
+
+    // Wakes all waiting threads.
+    // The calling thread should hold a lock while changing the protected state 
+    // but should release it before calling PulseAll.
+    inline void PulseAll();
+
+    // Performs one backoff step, returning when pulsed or when the step completes.
+    // The calling thread should hold a lock and should pass the lock as a parameter.
+    inline void Wait(Context *const context, LockType &lock);
+
+private:
+    static const uint32_t MIN_SPIN_LIMIT = 1;           // Minimum number of spin steps.
+    static const uint32_t MAX_SPIN_LIMIT = 64;          // Maximum number of spin steps.
+    static const uint32_t SPINS_PER_STEP = 64;          // Pause instructions per spin step.
+    static const uint32_t YIELD_LIMIT = 8;              // Number of yield steps before blocking.
+
+    YieldingMonitor(const YieldingMonitor &other);
+    YieldingMonitor &operator=(const YieldingMonitor &other);
+
+    template <class ValueType>
+    struct AF_PREALIGN(AF_CACHELINE_ALIGNMENT) Aligned {
+        ValueType value_;
+
+    } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
+
+    mutable Condition condition_;
+    Aligned<std::atomic<uint32_t> > pulses_;            // Incremented by each pulse, watched by spinning threads.
+    WaiterCount waiters_;                               // Threads blocked on the condition, and how many were signalled.
+};
+
+
+inline YieldingMonitor::YieldingMonitor()
+  : waiters_() {
+    pulses_.value_.store(0, std::memory_order_relaxed);
+}
+
+inline void YieldingMonitor::InitializeWorkerContext(Context *const context) {
+    context->backoff_ = 0;
+    context->spin_limit_ = MIN_SPIN_LIMIT;
+    context->parked_ = false;
+}
+
+AF_FORCEINLINE void YieldingMonitor::ResetYield(Context *const context) {
+    if (context->parked_) {
+        // Spinning didn't help last time, so spin less next time.
+        if (context->spin_limit_ > MIN_SPIN_LIMIT) {
+            context->spin_limit_ >>= 1;
+        }
+    } else if (context->backoff_ > context->spin_limit_) {
+        // Work arrived while we were yielding, so spin for longer next time.
+        if (context->spin_limit_ < MAX_SPIN_LIMIT) {
+            context->spin_limit_ <<= 1;
+        }
+    }
+
+    context->backoff_ = 0;
+    context->parked_ = false;
+}
+
+AF_FORCEINLINE bool YieldingMonitor::Pulse() {
+    pulses_.value_.fetch_add(1, std::memory_order_release);
+
+    // Spinning threads see the pulse count change; only blocked threads not yet signalled need waking.
+    if (!waiters_.Signal()) {
+        return false;
+    }
+
+    condition_.Pulse();
+    return true;
+}
+
+AF_FORCEINLINE uint32_t YieldingMonitor::Waiting() const {
+    return waiters_.Waiting();
+}
+
+AF_FORCEINLINE void YieldingMonitor::PulseAll() {
+    pulses_.value_.fetch_add(1, std::memory_order_release);
+    condition_.PulseAll();
+}
+
+AF_FORCEINLINE void YieldingMonitor::Wait(Context *const context, LockType &lock) {
+    const uint32_t step(context->backoff_++);
+
+    if (step < context->spin_limit_) {
+        // Spin without holding the lock until we're pulsed or the step is done.
+        const uint32_t pulses(pulses_.value_.load(std::memory_order_relaxed));
+        lock.Unlock();
+
+        uint32_t spins(SPINS_PER_STEP);
+        while (spins-- && pulses_.value_.load(std::memory_order_acquire) == pulses) {
+            Utils::Pause();
+        }
+
+        lock.Relock();
+        return;
+    }
+
+    if (step < context->spin_limit_ + YIELD_LIMIT) {
+        lock.Unlock();
+        std::this_thread::yield();
+        lock.Relock();
+        return;
+    }
+
+    // The caller checked its wait condition while holding the lock,
+    // so it's safe to block until the next pulse.
+    context->parked_ = true;
+
+    waiters_.Wait();
+    condition_.Wait(lock.lock_);
+    waiters_.Wake();
+}
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_SCHEDULER_YIELDINGMONITOR_H
@@ -16,6 +16,7 @@ namespace Detail
 
 /*
  * A copyable string type that is a lightweight wrapper around a pooled string.
+ * Each copy holds a reference to the pooled string, which is freed when the last copy is destroyed.
  */
 class String {
 public:
@@ -28,6 +29,32 @@ public:
         }
     }
 
+    AF_FORCEINLINE String(const String &other) : value_(other.value_) {
+        if (value_) {
+            StringPool::Acquire(value_);
+        }
+    }
+
+    AF_FORCEINLINE ~String() {
+        if (value_) {
+            StringPool::Release(value_);
+        }
+    }
+
+    AF_FORCEINLINE String &operator=(const String &other) {
+        // Acquire the new value first, in case it's the same string.
+        if (other.value_) {
+            StringPool::Acquire(other.value_);
+        }
+
+        if (value_) {
+            StringPool::Release(value_);
+        }
+
+        value_ = other.value_;
+        return *this;
+    }
+
     AF_FORCEINLINE bool IsNull() const {
         return (value_ == 0);
     }
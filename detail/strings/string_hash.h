@@ -37,6 +37,21 @@ public:
 
         return static_cast<uint32_t>(hash);
     }
+
+    /*
+     * Computes a 32-bit FNV-1a hash of the whole string.
+     */
+    AF_FORCEINLINE static uint32_t ComputeFull(const char *const str) {
+        AF_ASSERT(str);
+
+        uint32_t hash(2166136261U);
+        for (const char *ch(str); *ch != '\0'; ++ch) {
+            hash ^= static_cast<uint8_t>(*ch);
+            hash *= 16777619U;
+        }
+
+        return hash;
+    }
 };
 
 
@@ -16,6 +16,12 @@ StringPool *StringPool::instance_ = 0;
 Mutex StringPool::reference_mutex_;
 uint32_t StringPool::reference_count_ = 0;
 
+// Marks table slots whose entries were removed, so probes continue past them.
+static const uintptr_t REMOVED_ENTRY = 1;
+
+// Initial number of slots in the table of each shard.
+static const uint32_t INITIAL_CAPACITY = 16;
+
 
 void StringPool::Reference() {
     Lock lock(reference_mutex_);
@@ -36,9 +42,32 @@ void StringPool::Dereference() {
         AllocatorInterface *const allocator(AllocatorManager::GetCache());
         instance_->~StringPool();
         allocator->FreeWithSize(instance_, sizeof(StringPool));
+        instance_ = 0;
     }
 }
 
+void StringPool::Reclaim(Entry *const entry, const uint32_t hash) {
+    // The holder of the released string holds a reference to the pool too.
+    AF_ASSERT_MSG(instance_, "Pooled string outlived the string pool");
+
+    // The entry is freed only if it's still unreferenced once it's been removed,
+    // since another thread may have found it in the table in the meantime.
+    Shard &shard(instance_->GetShard(hash));
+
+    shard.lock_.Lock();
+    const bool removed(shard.Remove(entry, hash));
+    shard.lock_.Unlock();
+
+    if (!removed) {
+        return;
+    }
+
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+    const uint32_t size(entry->size_);
+    entry->~Entry();
+    allocator->FreeWithSize(entry, size);
+}
+
 StringPool::StringPool() {
 }
 
@@ -46,17 +75,188 @@ StringPool::~StringPool() {
 }
 
 const char *StringPool::Lookup(const char *const str) {
-    // Hash the string value to a bucket index.
-    const uint32_t index(Hash(str));
-    AF_ASSERT(index < BUCKET_COUNT);
-    Bucket &bucket(buckets_[index]);
+    // Hash the string value to a shard.
+    const uint32_t hash(Hash(str));
+    Shard &shard(GetShard(hash));
+
+    shard.lock_.Lock();
+    Entry *const existing(shard.Find(str, hash));
+    shard.lock_.Unlock();
+
+    if (existing) {
+        return existing->Value();
+    }
+
+    // Create the new entry outside the lock, then insert it unless another thread got there first.
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+    const uint32_t size(Entry::GetSize(str));
+    void *const memory(allocator->Allocate(size));
+    AF_ASSERT_MSG(memory, "Failed to allocate pooled string");
+
+    Entry *const created(Entry::Initialize(memory, str, hash));
+
+    shard.lock_.Lock();
+    Entry *const entry(shard.Insert(created));
+    shard.lock_.Unlock();
+
+    if (entry != created) {
+        created->~Entry();
+        allocator->FreeWithSize(created, size);
+    }
+
+    return entry->Value();
+}
+
+StringPool::Shard::Shard()
+  : lock_(),
+    slots_(0),
+    capacity_(0),
+    size_(0),
+    used_(0) {
+}
+
+StringPool::Shard::~Shard() {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    // Free all entries at end of day. Strings are released before the last reference to
+    // the pool, so any left in the table are unreferenced.
+    for (uint32_t index = 0; index < capacity_; ++index) {
+        Entry *const entry(slots_[index].entry_);
+        if (entry == 0 || reinterpret_cast<uintptr_t>(entry) == REMOVED_ENTRY) {
+            continue;
+        }
+
+        AF_ASSERT_MSG(entry->references_.load(std::memory_order_acquire) == 0, "Pooled string outlived the string pool");
+
+        const uint32_t size(entry->size_);
+        entry->~Entry();
+        allocator->FreeWithSize(entry, size);
+    }
+
+    if (slots_) {
+        allocator->FreeWithSize(slots_, capacity_ * sizeof(Slot));
+    }
+}
+
+StringPool::Entry *StringPool::Shard::Find(const char *const str, const uint32_t hash) {
+    if (capacity_ == 0) {
+        return 0;
+    }
+
+    // Probe linearly from the home slot until an empty slot ends the search.
+    const uint32_t mask(capacity_ - 1);
+    for (uint32_t index = hash & mask; slots_[index].entry_ != 0; index = (index + 1) & mask) {
+        const Slot &slot(slots_[index]);
+        if (slot.hash_ == hash &&
+            reinterpret_cast<uintptr_t>(slot.entry_) != REMOVED_ENTRY &&
+            strcmp(slot.entry_->Value(), str) == 0) {
+            // The entry may have just lost its last reference, but it's freed only if
+            // it's still unreferenced when removed from the table.
+            slot.entry_->references_.fetch_add(1, std::memory_order_relaxed);
+            return slot.entry_;
+        }
+    }
 
-    // Lock the mutex after computing the hash.
-    Lock lock(mutex_);
-    return bucket.Lookup(str);
+    return 0;
+}
+
+StringPool::Entry *StringPool::Shard::Insert(Entry *const entry) {
+    const char *const str(entry->Value());
+    const uint32_t hash(entry->hash_);
+
+    if (Entry *const existing = Find(str, hash)) {
+        return existing;
+    }
+
+    // Keep the table at most three quarters full, counting removed slots. The table grows
+    // only if it's at least half full of entries, otherwise it's just cleared of removed slots.
+    if ((used_ + 1) * 4 > capacity_ * 3) {
+        uint32_t capacity(capacity_ ? capacity_ : INITIAL_CAPACITY);
+        if ((size_ + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+
+        Resize(capacity);
+    }
+
+    // Take the first empty or removed slot along the probe sequence.
+    const uint32_t mask(capacity_ - 1);
+    uint32_t index(hash & mask);
+    while (slots_[index].entry_ != 0 && reinterpret_cast<uintptr_t>(slots_[index].entry_) != REMOVED_ENTRY) {
+        index = (index + 1) & mask;
+    }
+
+    if (slots_[index].entry_ == 0) {
+        ++used_;
+    }
+
+    slots_[index].hash_ = hash;
+    slots_[index].entry_ = entry;
+    ++size_;
+
+    return entry;
+}
+
+bool StringPool::Shard::Remove(Entry *const entry, const uint32_t hash) {
+    if (capacity_ == 0) {
+        return false;
+    }
+
+    // The entry may already have been removed and freed by another thread, and its memory
+    // reused for another entry, so it's located by address rather than dereferenced.
+    const uint32_t mask(capacity_ - 1);
+    for (uint32_t index = hash & mask; slots_[index].entry_ != 0; index = (index + 1) & mask) {
+        Slot &slot(slots_[index]);
+        if (slot.entry_ == entry) {
+            if (entry->references_.load(std::memory_order_acquire) != 0) {
+                return false;
+            }
+
+            slot.entry_ = reinterpret_cast<Entry *>(REMOVED_ENTRY);
+            --size_;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void StringPool::Shard::Resize(const uint32_t capacity) {
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    Slot *const slots(reinterpret_cast<Slot *>(allocator->Allocate(capacity * sizeof(Slot))));
+    AF_ASSERT_MSG(slots, "Failed to allocate string pool table");
+
+    for (uint32_t index = 0; index < capacity; ++index) {
+        slots[index].hash_ = 0;
+        slots[index].entry_ = 0;
+    }
+
+    // Reinsert the remaining entries, leaving the removed slots behind.
+    const uint32_t mask(capacity - 1);
+    for (uint32_t old_index = 0; old_index < capacity_; ++old_index) {
+        const Slot &slot(slots_[old_index]);
+        if (slot.entry_ == 0 || reinterpret_cast<uintptr_t>(slot.entry_) == REMOVED_ENTRY) {
+            continue;
+        }
+
+        uint32_t index(slot.hash_ & mask);
+        while (slots[index].entry_ != 0) {
+            index = (index + 1) & mask;
+        }
+
+        slots[index] = slot;
+    }
+
+    if (slots_) {
+        allocator->FreeWithSize(slots_, capacity_ * sizeof(Slot));
+    }
+
+    slots_ = slots;
+    capacity_ = capacity;
+    used_ = size_;
 }
 
 
 } // namespace Detail
 } // namespace AF
-
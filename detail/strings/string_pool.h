@@ -9,10 +9,12 @@
 #include "AF/basic_types.h"
 #include "AF/defines.h"
 
-#include "AF/detail/containers/list.h"
+#include "AF/detail/strings/string_hash.h"
 
 #include "AF/detail/threading/mutex.h"
+#include "AF/detail/threading/spin_lock.h"
 
+#include <atomic>
 #include <new>
 #include <string.h>
 #include <stdlib.h>
@@ -25,7 +27,14 @@ namespace Detail
 
 
 /*
- * Static class that manages a pool of unique strings.
+ * Static class that manages a pool of unique, reference-counted strings.
+ *
+ * The pool is split into shards selected by the hash of the string, each with its own lock
+ * and open-addressed table of entries, so lookups of different strings rarely contend.
+ * Pooled strings are freed when their last reference is released.
+ *
+ * Every holder of a pooled string must also hold a Ref to the pool, released only after
+ * the string, so no string outlives the pool and releasing one never races its destruction.
  */
 class StringPool {
 public:
@@ -45,12 +54,21 @@ public:
 
     friend class Ref;
 
-    // Gets the address of the pooled version of the given literal string.
+    // Gets the address of the pooled version of the given literal string, holding a reference to it.
     // The pooled version is created if it doesn't already exist.
     inline static const char *Get(const char *const str);
 
+    // Adds a reference to a pooled string returned by Get.
+    inline static void Acquire(const char *const value);
+
+    // Releases a reference to a pooled string, freeing it if it was the last reference.
+    inline static void Release(const char *const value);
+
 private:
-    class Entry : public List<Entry>::Node {
+    /*
+     * Header of a pooled string, which is stored directly before it.
+     */
+    class Entry {
     public:
         AF_FORCEINLINE static uint32_t GetSize(const char *const str) {
             const uint32_t length(static_cast<uint32_t>(strlen(str)));
@@ -60,71 +78,74 @@ private:
             return sizeof(Entry) + rounded_length;
         }
 
-        AF_FORCEINLINE static Entry *Initialize(void *const memory, const char *const str) {
+        AF_FORCEINLINE static Entry *Initialize(void *const memory, const char *const str, const uint32_t hash) {
             char *const buffer(reinterpret_cast<char *>(memory) + sizeof(Entry));
             strcpy(buffer, str);
 
-            return new (memory) Entry(buffer);
+            return new (memory) Entry(hash, GetSize(str));
         }
 
-        AF_FORCEINLINE explicit Entry(const char *const val) : value_(val) {
+        AF_FORCEINLINE static Entry *FromValue(const char *const value) {
+            return reinterpret_cast<Entry *>(const_cast<char *>(value) - sizeof(Entry));
+        }
+
+        AF_FORCEINLINE Entry(const uint32_t hash, const uint32_t size)
+          : references_(1),
+            hash_(hash),
+            size_(size) {
         }
 
         AF_FORCEINLINE const char *Value() const {
-            return value_;
+            return reinterpret_cast<const char *>(this) + sizeof(Entry);
         }
 
-    private:
-        const char *value_;
+        std::atomic<uint32_t> references_;      // Number of references held to the string.
+        uint32_t hash_;                         // Cached hash of the string.
+        uint32_t size_;                         // Allocated size of the entry, including the string.
+    };
+
+    /*
+     * A slot in the table of a shard, caching the hash of its entry so probes rarely touch the string.
+     */
+    struct Slot {
+        uint32_t hash_;
+        Entry *entry_;
     };
 
-    class Bucket {
+    /*
+     * An open-addressed table of entries, protected by its own lock.
+     */
+    class AF_PREALIGN(AF_CACHELINE_ALIGNMENT) Shard {
     public:
-        inline Bucket() {
-        }
+        Shard();
+        ~Shard();
 
-        inline ~Bucket() {
-            AllocatorInterface *const allocator(AllocatorManager::GetCache());
+        // Finds the entry for a given string and adds a reference to it, or returns zero if there's none.
+        Entry *Find(const char *const str, const uint32_t hash);
 
-            // Free all entries at end of day.
-            while (!entries_.Empty()) {
-                Entry *const entry(entries_.Front());
-                entries_.Remove(entry);
+        // Inserts a new entry, unless an entry for the same string was inserted first.
+        // Returns the entry now in the table, holding a reference to it.
+        Entry *Insert(Entry *const entry);
 
-                const uint32_t size(Entry::GetSize(entry->Value()));
-                entry->~Entry();
-                allocator->FreeWithSize(entry, size);
-            }
-        }
+        // Removes an entry whose last reference has been released, if it's still unreferenced.
+        // Returns true if the entry was removed.
+        bool Remove(Entry *const entry, const uint32_t hash);
 
-        AF_FORCEINLINE const char *Lookup(const char *const str) {
-            AllocatorInterface *const allocator(AllocatorManager::GetCache());
-            Entry *entry(0);
-
-            // Search the bucket for an an existing entry for this string.
-            List<Entry>::Iterator entries(entries_.GetIterator());
-            while (entries.Next()) {
-                Entry *const e(entries.Get());
-                if (strcmp(e->Value(), str) == 0) {
-                    entry = e;
-                    break;
-                }
-            }
-
-            if (entry == 0) {
-                // Create a new entry.
-                const uint32_t size(Entry::GetSize(str));
-                void *const memory(allocator->Allocate(size));
-                entry = Entry::Initialize(memory, str);
-                entries_.Insert(entry);
-            }
-
-            return entry->Value();
-        }
+        SpinLock lock_;             // Protects the table.
 
     private:
-        List<Entry> entries_;
-    };
+        Shard(const Shard &other);
+        Shard &operator=(const Shard &other);
+
+        // Reallocates the table with the given capacity, dropping removed slots.
+        void Resize(const uint32_t capacity);
+
+        Slot *slots_;               // Table of slots, with a power-of-two capacity.
+        uint32_t capacity_;         // Number of slots in the table.
+        uint32_t size_;             // Number of slots holding entries.
+        uint32_t used_;             // Number of slots holding entries or marked as removed.
+
+    } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
 
     // References the string pool, creating the singleton instance if it doesn't already exist.
     static void Reference();
@@ -132,13 +153,17 @@ private:
     // Releases a reference to the string pool, destroying the singleton instance if it is no longer referenced.
     static void Dereference();
 
+    // Frees an entry whose last reference has been released.
+    static void Reclaim(Entry *const entry, const uint32_t hash);
+
     inline static uint32_t Hash(const char *const str);
 
     static StringPool *instance_;                   // Pointer to the singleton instance.
     static Mutex reference_mutex_;                  // Synchronization object protecting reference counting.
     static uint32_t reference_count_;               // Counts the number of references to the singleton.
 
-    static const uint32_t BUCKET_COUNT = 128;
+    static const uint32_t SHARD_BITS = 6;
+    static const uint32_t SHARD_COUNT = 1 << SHARD_BITS;
 
     StringPool();
     ~StringPool();
@@ -146,8 +171,12 @@ private:
     // Finds the entry for a given string, and creates it if it doesn't exist yet.
     const char *Lookup(const char *const str);
 
-    Mutex mutex_;
-    Bucket buckets_[BUCKET_COUNT];
+    AF_FORCEINLINE Shard &GetShard(const uint32_t hash) {
+        // Shards are selected by the high bits of the hash, and slots within shards by the low bits.
+        return shards_[hash >> (32 - SHARD_BITS)];
+    }
+
+    Shard shards_[SHARD_COUNT];
 };
 
 
@@ -158,25 +187,26 @@ AF_FORCEINLINE const char *StringPool::Get(const char *const str) {
     return instance_->Lookup(str);
 }
 
-AF_FORCEINLINE uint32_t StringPool::Hash(const char *const str) {
-    AF_ASSERT(str);
+AF_FORCEINLINE void StringPool::Acquire(const char *const value) {
+    AF_ASSERT(value);
+
+    Entry::FromValue(value)->references_.fetch_add(1, std::memory_order_relaxed);
+}
 
-    // XOR the first n characters of the string together.
-    const char *const end(str + 64);
+AF_FORCEINLINE void StringPool::Release(const char *const value) {
+    AF_ASSERT(value);
 
-    const char *ch(str);
-    uint8_t hash(0);
+    // Read the entry before releasing our reference, after which it may be freed by another thread.
+    Entry *const entry(Entry::FromValue(value));
+    const uint32_t hash(entry->hash_);
 
-    while (ch != end && *ch != '\0') {
-        hash ^= static_cast<uint8_t>(*ch);
-        ++ch;
+    if (entry->references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        Reclaim(entry, hash);
     }
+}
 
-    // Zero the 8th bit since it's usually zero anyway in ASCII.
-    // This gives an effective range of [0, 127].
-    hash &= 127;
-
-    return static_cast<uint32_t>(hash);
+AF_FORCEINLINE uint32_t StringPool::Hash(const char *const str) {
+    return StringHash::ComputeFull(str);
 }
 
 
@@ -185,4 +215,3 @@ AF_FORCEINLINE uint32_t StringPool::Hash(const char *const str) {
 
 
 #endif // AF_DETAIL_STRINGS_STRINGPOOL_H
-
@@ -36,12 +36,25 @@ public:
             std::memory_order_acquire);
     }
 
-    AF_FORCEINLINE void Increment() {
-        ++value_;
+    // Sets the value if it equals the current value, which is updated on failure.
+    // Unlike CompareExchangeAcquire this is fully ordered.
+    AF_FORCEINLINE bool CompareExchange(uint32_t &current_value, const uint32_t new_value) {
+        return value_.compare_exchange_weak(current_value, new_value);
     }
 
-    AF_FORCEINLINE void Decrement() {
-        --value_;
+    // Increments the value, returning the new value.
+    AF_FORCEINLINE uint32_t Increment() {
+        return ++value_;
+    }
+
+    // Decrements the value, returning the new value.
+    AF_FORCEINLINE uint32_t Decrement() {
+        return --value_;
+    }
+
+    // Sets the value, returning the previous value.
+    AF_FORCEINLINE uint32_t Exchange(const uint32_t new_value) {
+        return value_.exchange(new_value);
     }
 
     AF_FORCEINLINE uint32_t Load() const {
@@ -0,0 +1,81 @@
+#ifndef AF_DETAIL_THREADING_WAITERCOUNT_H
+#define AF_DETAIL_THREADING_WAITERCOUNT_H
+
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+#include <atomic>
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * Counts the threads blocked on a condition, distinguishing those still waiting for a signal
+ * from those already signalled but not yet awake. Signals are only needed while some blocked
+ * thread hasn't been signalled yet, so repeated signalling can't wake the same thread twice.
+ *
+ * Both counts are packed in one word so a waking thread can always tell which one it leaves.
+ */
+class WaiterCount {
+public:
+    AF_FORCEINLINE WaiterCount() : state_(0) {
+    }
+
+    // Counts the calling thread as waiting. Called while holding the condition's lock, before blocking.
+    AF_FORCEINLINE void Wait() {
+        state_.fetch_add(WAITING, std::memory_order_relaxed);
+    }
+
+    // Gets the number of blocked threads not yet signalled.
+    AF_FORCEINLINE uint32_t Waiting() const {
+        return state_.load(std::memory_order_relaxed) / WAITING;
+    }
+
+    // Marks one waiting thread as signalled, returning false if every blocked thread already has been.
+    // Callers that get true should then signal the condition.
+    AF_FORCEINLINE bool Signal() {
+        uint32_t state(state_.load(std::memory_order_relaxed));
+        while (state >= WAITING) {
+            if (state_.compare_exchange_weak(state, state - WAITING + SIGNALLED, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Stops counting the calling thread once it has woken, consuming a signal if there's one.
+    // Any woken thread may consume any signal, which leaves the total count correct either way.
+    AF_FORCEINLINE void Wake() {
+        uint32_t state(state_.load(std::memory_order_relaxed));
+        while (true) {
+            AF_ASSERT(state != 0);
+
+            const uint32_t next((state & SIGNALLED_MASK) ? state - SIGNALLED : state - WAITING);
+            if (state_.compare_exchange_weak(state, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+private:
+    static const uint32_t SIGNALLED = 1;                // Unit of the signalled count, in the low half.
+    static const uint32_t SIGNALLED_MASK = 0xFFFF;      // Mask of the signalled count.
+    static const uint32_t WAITING = 1 << 16;            // Unit of the waiting count, in the high half.
+
+    WaiterCount(const WaiterCount &other);
+    WaiterCount &operator=(const WaiterCount &other);
+
+    std::atomic<uint32_t> state_;       // Waiting threads in the high half, signalled threads in the low half.
+};
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_THREADING_WAITERCOUNT_H
@@ -0,0 +1,47 @@
+#ifndef AF_DETAIL_UTILS_TYPEID_H
+#define AF_DETAIL_UTILS_TYPEID_H
+
+
+#include "AF/defines.h"
+
+
+namespace AF
+{
+namespace Detail
+{
+
+/*
+ * Opaque identifier of a C++ type, unique within the process.
+ */
+typedef const void *TypeId;
+
+
+/*
+ * Generates type identifiers without relying on RTTI or on registration of the type.
+ *
+ * Each instantiation of the template owns a static marker variable, whose address
+ * identifies the type. Type identifiers can be compared for equality in a single
+ * instruction, and are known at link time. The marker isn't const, so that the
+ * linker can't fold the markers of different types together.
+ */
+template <class Type>
+class TypeIdOf {
+public:
+    AF_FORCEINLINE static TypeId Get() {
+        return &marker_;
+    }
+
+private:
+    static char marker_;
+};
+
+
+template <class Type>
+char TypeIdOf<Type>::marker_ = 0;
+
+
+} // namespace Detail
+} // namespace AF
+
+
+#endif // AF_DETAIL_UTILS_TYPEID_H
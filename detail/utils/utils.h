@@ -22,6 +22,9 @@ public:
     // This function is intentionally not force-inlined.
     inline static void Backoff(uint32_t &backoff);
 
+    // Hints to the processor that the calling thread is busy-waiting.
+    inline static void Pause();
+
     // Put the calling thread to sleep for a given number of milliseconds.
     inline static void SleepThread(const uint32_t milliseconds);
 
@@ -35,6 +38,14 @@ inline void Utils::Backoff(uint32_t &backoff) {
     std::this_thread::yield();
 }
 
+AF_FORCEINLINE void Utils::Pause() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
 AF_FORCEINLINE void Utils::SleepThread(const uint32_t milliseconds) {
     AF_ASSERT(milliseconds < 1000);
     std::this_thread::sleep_for(std::chrono::microseconds(milliseconds * 1000));
@@ -44,39 +55,41 @@ AF_FORCEINLINE void Utils::SleepThread(const uint32_t milliseconds) {
  * Union that combines a framework index and a mailbox index.
  */
 union Index {
-    AF_FORCEINLINE Index() : uint32_(0) {
+    AF_FORCEINLINE Index() : uint64_(0) {
     }
 
-    AF_FORCEINLINE Index(const uint32_t framework, const uint32_t index) : uint32_(0) {
+    AF_FORCEINLINE Index(const uint32_t framework, const uint32_t index, const uint32_t generation = 0) : uint64_(0) {
         componets_.framework_ = framework;
         componets_.index_ = index;
+        componets_.generation_ = generation;
     }
 
-    AF_FORCEINLINE Index(const Index &other) : uint32_(other.uint32_) {
+    AF_FORCEINLINE Index(const Index &other) : uint64_(other.uint64_) {
     }
 
     AF_FORCEINLINE Index &operator=(const Index &other) {
-        uint32_ = other.uint32_;
+        uint64_ = other.uint64_;
         return *this;
     }
 
     AF_FORCEINLINE bool operator==(const Index &other) const {
-        return (uint32_ == other.uint32_);
+        return (uint64_ == other.uint64_);
     }
 
     AF_FORCEINLINE bool operator!=(const Index &other) const {
-        return (uint32_ != other.uint32_);
+        return (uint64_ != other.uint64_);
     }
 
     AF_FORCEINLINE bool operator<(const Index &other) const {
-        return (uint32_ < other.uint32_);
+        return (uint64_ < other.uint64_);
     }
 
-    uint32_t uint32_;               // Unsigned 32-bit value.
+    uint64_t uint64_;               // Unsigned 64-bit value.
 
     struct {
         uint32_t framework_ : 12;  // Integer index identifying the framework within the local process (zero indicates a receiver).
         uint32_t index_ : 20;      // Integer index of the actor within the framework (or receiver within the process).
+        uint32_t generation_;      // Number of times the index had been reused when the address was issued.
 
     } componets_;
 };
@@ -94,6 +107,20 @@ public:
         sprintf(buffer, "%x", id);
     }
 
+    // Names reused indices apart by their generation. First-generation names are unchanged.
+    inline static void Generate(
+        char *const buffer,
+        const uint32_t id,
+        const uint32_t generation) {
+        AF_ASSERT(buffer);
+
+        if (generation == 0) {
+            sprintf(buffer, "%x", id);
+        } else {
+            sprintf(buffer, "%x-%x", id, generation);
+        }
+    }
+
     inline static void Combine(
         char *const buffer,
         const uint32_t buffer_size,
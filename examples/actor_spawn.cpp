@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <thread>
+#include <vector>
+
+#include "AF/AF.h"
+#include "timer.h"
+
+
+// Number of actors each spawning thread holds at once before destroying them.
+static const int BATCH_SIZE = 64;
+
+
+// An actor with no handlers, so the benchmark measures only the cost of creation and destruction.
+class EmptyActor : public AF::Actor {
+public:
+
+    explicit EmptyActor(AF::Framework &framework) : AF::Actor(framework) {
+    }
+};
+
+
+// Repeatedly creates a batch of unnamed actors and then destroys them.
+static void Spawn(AF::Framework *const framework, const int count) {
+    EmptyActor *actors[BATCH_SIZE];
+
+    for (int spawned = 0; spawned < count; spawned += BATCH_SIZE) {
+        for (int index = 0; index < BATCH_SIZE; ++index) {
+            actors[index] = new EmptyActor(*framework);
+        }
+
+        for (int index = 0; index < BATCH_SIZE; ++index) {
+            delete actors[index];
+        }
+    }
+}
+
+
+int main(int argc, char *argv[]) {
+    const int count = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 100000;
+    const int threads = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 4;
+
+    printf("Using count = %d (use first command line argument to change)\n", count);
+    printf("Using threads = %d (use second command line argument to change)\n", threads);
+    printf("Spawning and destroying %d actors per thread in batches of %d...\n", count, BATCH_SIZE);
+
+    AF::Framework framework;
+
+    for (int thread_count = 1; thread_count <= threads; thread_count *= 2) {
+        std::vector<std::thread> spawners;
+
+        Timer timer;
+        timer.Start();
+
+        for (int index = 0; index < thread_count; ++index) {
+            spawners.push_back(std::thread(Spawn, &framework, count));
+        }
+
+        for (int index = 0; index < thread_count; ++index) {
+            spawners[index].join();
+        }
+
+        timer.Stop();
+
+        const float spawns(static_cast<float>(count) * thread_count);
+        printf("    %d thread(s): %.0f spawns per second, %.2f us per spawn\n",
+            thread_count,
+            spawns / timer.Seconds(),
+            timer.Seconds() * 1e6f / spawns);
+    }
+
+    // Generated names are built on demand, so naming an actor is only paid for when it's asked for.
+    EmptyActor actor(framework);
+    printf("Default actor name: %s\n", actor.GetAddress().AsString());
+}
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "AF/AF.h"
+#include "AF/detail/allocators/pool.h"
+#include "timer.h"
+
+
+// Number of blocks cached per pool, matching the default cache depth.
+static const uint32_t POOL_SIZE = 16;
+
+// Number of blocks of each kind held by the simulated senders at any time.
+static const uint32_t LIVE_BLOCKS = 8;
+
+
+// A cache-line aligned message, as used for messages sent between actors on different cores.
+struct AF_PREALIGN(AF_CACHELINE_ALIGNMENT) AlignedMessage {
+    int value_;
+
+} AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
+
+
+AF_ALIGN_MESSAGE(AlignedMessage, AF_CACHELINE_ALIGNMENT);
+
+
+// Reference pool holding all blocks in one list, which has to be searched for an aligned block.
+class LinearPool {
+public:
+
+    LinearPool() : head_(0), count_(0) {
+    }
+
+    bool Add(void *const memory) {
+        if (count_ == POOL_SIZE) {
+            return false;
+        }
+
+        Node *const node(reinterpret_cast<Node *>(memory));
+        node->next_ = head_;
+        head_ = node;
+        ++count_;
+        return true;
+    }
+
+    void *FetchAligned(const uint32_t alignment) {
+        Node **link(&head_);
+        while (Node *const node = *link) {
+            if (AF_ALIGNED(node, alignment)) {
+                *link = node->next_;
+                --count_;
+                return node;
+            }
+
+            link = &node->next_;
+        }
+
+        return 0;
+    }
+
+    void *Fetch() {
+        Node *const node(head_);
+        if (node) {
+            head_ = node->next_;
+            --count_;
+        }
+
+        return node;
+    }
+
+private:
+
+    struct Node {
+        Node *next_;
+    };
+
+    Node *head_;
+    uint32_t count_;
+};
+
+
+// Simulates a message cache shared by cache-line aligned messages and ordinary messages of the
+// same size. Blocks are allocated and freed in a pseudo-random order, with blocks missing from
+// the pool allocated from the real allocator. Returns the number of such misses.
+template <class PoolType>
+uint32_t Run(PoolType &pool, const int iterations, float &seconds) {
+    AF::AllocatorInterface *const allocator(AF::AllocatorManager::GetAllocator());
+    const uint32_t alignments[2] = { sizeof(void *), AF_CACHELINE_ALIGNMENT };
+
+    void *live[2][LIVE_BLOCKS] = { { 0 } };
+    uint32_t seed(12345);
+    uint32_t misses(0);
+
+    Timer timer;
+    timer.Start();
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        seed = seed * 1103515245 + 12345;
+
+        const uint32_t kind((seed >> 16) & 1);
+        void *&block(live[kind][(seed >> 17) % LIVE_BLOCKS]);
+
+        if (block) {
+            // Free the block, returning it to the real allocator if the pool is full.
+            if (!pool.Add(block)) {
+                allocator->Free(block);
+            }
+
+            block = 0;
+        } else {
+            block = pool.FetchAligned(alignments[kind]);
+            if (block == 0) {
+                block = allocator->AllocateAligned(sizeof(AlignedMessage), alignments[kind]);
+                ++misses;
+            }
+        }
+    }
+
+    timer.Stop();
+    seconds = timer.Seconds();
+
+    for (uint32_t kind = 0; kind < 2; ++kind) {
+        for (uint32_t index = 0; index < LIVE_BLOCKS; ++index) {
+            if (live[kind][index]) {
+                allocator->Free(live[kind][index]);
+            }
+        }
+    }
+
+    while (void *const block = pool.Fetch()) {
+        allocator->Free(block);
+    }
+
+    return misses;
+}
+
+
+// Fetches cache-line aligned blocks from a pool holding only blocks without that alignment,
+// as happens when a pool is refilled by ordinary messages of the same size. Each cycle also
+// recycles one block so both pools do the same amount of other work.
+template <class PoolType>
+float RunMissing(PoolType &pool, void **const blocks, const int iterations, uint32_t &hits) {
+    for (uint32_t index = 0; index < POOL_SIZE; ++index) {
+        pool.Add(blocks[index]);
+    }
+
+    Timer timer;
+    timer.Start();
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        if (pool.FetchAligned(AF_CACHELINE_ALIGNMENT)) {
+            ++hits;
+        }
+
+        pool.Add(pool.Fetch());
+    }
+
+    timer.Stop();
+
+    while (pool.Fetch()) {
+    }
+
+    return timer.Seconds();
+}
+
+
+int main(int argc, char *argv[]) {
+    const int iterations = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 10000000;
+
+    printf("Using iterations = %d (use first command line argument to change)\n", iterations);
+    printf("Allocating %d-byte blocks aligned to %d and %d bytes through pools of %d blocks...\n",
+        static_cast<int>(sizeof(AlignedMessage)),
+        static_cast<int>(sizeof(void *)),
+        AF_CACHELINE_ALIGNMENT,
+        POOL_SIZE);
+
+    LinearPool linear_pool;
+    AF::Detail::Pool<POOL_SIZE> pool;
+
+    // Carve blocks out of a cache-line aligned buffer, offset so none of them are cache-line aligned.
+    AF::AllocatorInterface *const allocator(AF::AllocatorManager::GetAllocator());
+    const uint32_t stride(AF_CACHELINE_ALIGNMENT * 2);
+    uint8_t *const buffer(static_cast<uint8_t *>(allocator->AllocateAligned(stride * POOL_SIZE, AF_CACHELINE_ALIGNMENT)));
+
+    void *blocks[POOL_SIZE];
+    for (uint32_t index = 0; index < POOL_SIZE; ++index) {
+        blocks[index] = buffer + index * stride + sizeof(void *);
+    }
+
+    uint32_t hits(0);
+    const float linear_missing(RunMissing(linear_pool, blocks, iterations, hits));
+    const float pool_missing(RunMissing(pool, blocks, iterations, hits));
+
+    if (hits != 0) {
+        printf("ERROR: Fetched %u blocks that should have been misaligned\n", hits);
+    }
+
+    printf("No aligned blocks in pool:\n");
+    printf("    Linear search:    %.1f ns per fetch\n", linear_missing * 1e9f / iterations);
+    printf("    Alignment lists:  %.1f ns per fetch\n", pool_missing * 1e9f / iterations);
+
+    allocator->Free(buffer);
+
+    float linear_seconds(0.0f);
+    float pool_seconds(0.0f);
+    const uint32_t linear_misses(Run(linear_pool, iterations, linear_seconds));
+    const uint32_t pool_misses(Run(pool, iterations, pool_seconds));
+
+    printf("Mixed aligned and ordinary blocks:\n");
+    printf("    Linear search:    %.1f ns per operation, %u allocations missed the pool\n",
+        linear_seconds * 1e9f / iterations,
+        linear_misses);
+    printf("    Alignment lists:  %.1f ns per operation, %u allocations missed the pool\n",
+        pool_seconds * 1e9f / iterations,
+        pool_misses);
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+
+#include "AF/AF.h"
+#include "timer.h"
+
+
+// How long to wait for the bystander to get a turn before declaring it starved.
+static const float TIMEOUT_SECONDS = 10.0f;
+
+
+// An actor that keeps itself busy by messaging itself until it's stopped,
+// so its mailbox is never empty.
+class Spinner : public AF::Actor {
+public:
+
+    explicit Spinner(AF::Framework &framework) :
+      AF::Actor(framework),
+      stopped_(false),
+      handled_(0) {
+        RegisterHandler(this, &Spinner::Handle);
+    }
+
+    std::atomic<bool> stopped_;
+    std::atomic<int> handled_;
+
+private:
+
+    void Handle(const int &message, const AF::Address /*from*/) {
+        ++handled_;
+
+        if (!stopped_.load()) {
+            Send(message + 1, GetAddress());
+        }
+    }
+};
+
+
+// An actor that notes how busy the spinner had been when it got its turn.
+class Bystander : public AF::Actor {
+public:
+
+    Bystander(AF::Framework &framework, const Spinner *const spinner) :
+      AF::Actor(framework),
+      waited_(-1),
+      spinner_(spinner) {
+        RegisterHandler(this, &Bystander::Handle);
+    }
+
+    std::atomic<int> waited_;
+
+private:
+
+    void Handle(const int &/*message*/, const AF::Address /*from*/) {
+        waited_.store(spinner_->handled_.load());
+    }
+
+    const Spinner *const spinner_;
+};
+
+
+// Messages a bystander while a spinner is busy on the only worker thread, and checks
+// the bystander gets a turn once the spinner has spent its throughput budget.
+static bool TestFairness(const AF::QueueStrategy queue_strategy, const uint32_t throughput) {
+    AF::Framework::Parameters params(1, AF::YIELD_STRATEGY_BLOCKING, queue_strategy, throughput);
+    AF::Framework framework(params);
+
+    Spinner spinner(framework);
+    Bystander bystander(framework, &spinner);
+
+    AF::Receiver receiver;
+    framework.Send(0, receiver.GetAddress(), spinner.GetAddress());
+
+    // Let the spinner get going before the bystander is messaged.
+    while (spinner.handled_.load() < 1000) {
+        std::this_thread::yield();
+    }
+
+    const int before(spinner.handled_.load());
+    framework.Send(0, receiver.GetAddress(), bystander.GetAddress());
+
+    Timer timer;
+    timer.Start();
+
+    bool passed(true);
+    while (bystander.waited_.load() < 0) {
+        timer.Stop();
+        if (timer.Seconds() > TIMEOUT_SECONDS) {
+            passed = false;
+            break;
+        }
+
+        std::this_thread::yield();
+    }
+
+    spinner.stopped_.store(true);
+
+    printf("    %s queue: bystander %s after %d spinner messages\n",
+        queue_strategy == AF::QUEUE_STRATEGY_SHARED ? "Shared" : "Work-stealing",
+        passed ? "ran" : "starved",
+        (passed ? bystander.waited_.load() : spinner.handled_.load()) - before);
+
+    // Wait for the spinner to stop so the framework can be torn down.
+    while (spinner.GetNumQueuedMessages()) {
+        std::this_thread::yield();
+    }
+
+    return passed;
+}
+
+
+int main(int argc, char *argv[]) {
+    const int throughput = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 16;
+
+    printf("Using throughput = %d (use first command line argument to change)\n", throughput);
+    printf("Messaging an actor while another keeps the only worker thread busy...\n");
+
+    const bool shared(TestFairness(AF::QUEUE_STRATEGY_SHARED, throughput));
+    const bool stealing(TestFairness(AF::QUEUE_STRATEGY_WORK_STEALING, throughput));
+
+    return (shared && stealing) ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "AF/AF.h"
+#include "timer.h"
+
+
+// How long to wait for messages to be handled before declaring them lost.
+static const float TIMEOUT_SECONDS = 10.0f;
+
+
+// A message numbered in the order its sender sent it.
+struct Numbered {
+    int sender_;
+    int sequence_;
+};
+
+
+// Waits until the given count reaches the expected value, returning false on timeout.
+static bool WaitFor(const std::atomic<int> &count, const int expected) {
+    Timer timer;
+    timer.Start();
+
+    while (count.load() < expected) {
+        timer.Stop();
+        if (timer.Seconds() > TIMEOUT_SECONDS) {
+            return false;
+        }
+
+        std::this_thread::yield();
+    }
+
+    return true;
+}
+
+
+// An actor with a credit window of one, so nearly every concurrent send is deferred.
+class Consumer : public AF::Actor {
+public:
+
+    Consumer(AF::Framework &framework, const int senders) :
+      AF::Actor(framework),
+      next_(senders, 0),
+      handled_(0),
+      misordered_(0) {
+        SetCreditWindow(1, AF::FLOW_CONTROL_DEFER);
+        RegisterHandler(this, &Consumer::Handle);
+    }
+
+    std::vector<int> next_;
+    std::atomic<int> handled_;
+    std::atomic<int> misordered_;
+
+private:
+
+    void Handle(const Numbered &message, const AF::Address /*from*/) {
+        // Deferred messages are admitted in the order they were sent.
+        if (message.sequence_ != next_[message.sender_]) {
+            ++misordered_;
+        }
+
+        next_[message.sender_] = message.sequence_ + 1;
+        ++handled_;
+    }
+};
+
+
+// Sends a run of numbered messages to the consumer from outside the framework.
+static void Produce(AF::Framework *const framework, const AF::Address to, const int sender, const int count) {
+    AF::Receiver receiver;
+
+    for (int sequence = 0; sequence < count; ++sequence) {
+        const Numbered message = { sender, sequence };
+        framework->Send(message, receiver.GetAddress(), to);
+    }
+}
+
+
+// An actor with a credit window of one that blocks its senders, and holds on to its
+// worker thread until it's opened.
+class Gate : public AF::Actor {
+public:
+
+    explicit Gate(AF::Framework &framework) :
+      AF::Actor(framework),
+      open_(false),
+      handled_(0) {
+        SetCreditWindow(1, AF::FLOW_CONTROL_BLOCK);
+        RegisterHandler(this, &Gate::Handle);
+    }
+
+    std::atomic<bool> open_;
+    std::atomic<int> handled_;
+
+private:
+
+    void Handle(const int &/*message*/, const AF::Address /*from*/) {
+        while (!open_.load()) {
+            std::this_thread::yield();
+        }
+
+        ++handled_;
+    }
+};
+
+
+// An actor that sends its messages to the gate from its constructor.
+class Child : public AF::Actor {
+public:
+
+    Child(AF::Framework &framework, const AF::Address gate, const int count) : AF::Actor(framework) {
+        for (int index = 0; index < count; ++index) {
+            Send(index, gate);
+        }
+    }
+};
+
+
+// Sends to the gate, from a handler directly or from the constructor of an actor it creates.
+class Sender : public AF::Actor {
+public:
+
+    Sender(AF::Framework &framework, const AF::Address gate, const int count) :
+      AF::Actor(framework),
+      gate_(gate),
+      count_(count) {
+        RegisterHandler(this, &Sender::Send);
+        RegisterHandler(this, &Sender::Spawn);
+    }
+
+private:
+
+    void Send(const int &/*message*/, const AF::Address /*from*/) {
+        for (int index = 0; index < count_; ++index) {
+            AF::Actor::Send(index, gate_);
+        }
+    }
+
+    void Spawn(const float &/*message*/, const AF::Address /*from*/) {
+        Child child(GetFramework(), gate_, count_);
+    }
+
+    const AF::Address gate_;
+    const int count_;
+};
+
+
+// Opens the gate, from the same worker thread as the senders.
+class Opener : public AF::Actor {
+public:
+
+    Opener(AF::Framework &framework, Gate *const gate) : AF::Actor(framework), gate_(gate) {
+        RegisterHandler(this, &Opener::Handle);
+    }
+
+private:
+
+    void Handle(const bool &/*message*/, const AF::Address /*from*/) {
+        gate_->open_.store(true);
+    }
+
+    Gate *const gate_;
+};
+
+
+// Floods an actor with a credit window of one from several threads at once, and checks
+// that every deferred message is admitted, even if the consumer had drained its mailbox
+// just as the message was deferred.
+static bool TestDeferring(const int count, const int senders, const int rounds) {
+    for (int round = 0; round < rounds; ++round) {
+        AF::Framework framework(2);
+        Consumer consumer(framework, senders);
+
+        std::vector<std::thread> producers;
+        for (int sender = 0; sender < senders; ++sender) {
+            producers.push_back(std::thread(Produce, &framework, consumer.GetAddress(), sender, count));
+        }
+
+        for (int sender = 0; sender < senders; ++sender) {
+            producers[sender].join();
+        }
+
+        if (!WaitFor(consumer.handled_, count * senders) || consumer.misordered_.load() != 0) {
+            printf("    Round %d: handled %d of %d messages, %d out of order\n",
+                round,
+                consumer.handled_.load(),
+                count * senders,
+                consumer.misordered_.load());
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Sends to a blocking actor from a single worker thread, which must defer rather than block.
+// In another framework it'd never run the actor that opens the gate, and in the gate's own
+// framework, where the gate starts open, it'd never run the gate itself.
+static bool TestBlocking(const bool same_framework, const bool from_constructor) {
+    AF::Framework gate_framework(1);
+    AF::Framework sender_framework(1);
+    AF::Framework &framework(same_framework ? gate_framework : sender_framework);
+
+    Gate gate(gate_framework);
+    gate.open_.store(same_framework);
+    Sender sender(framework, gate.GetAddress(), 4);
+    Opener opener(framework, &gate);
+
+    AF::Receiver receiver;
+    if (from_constructor) {
+        framework.Send(0.0f, receiver.GetAddress(), sender.GetAddress());
+    } else {
+        framework.Send(0, receiver.GetAddress(), sender.GetAddress());
+    }
+
+    framework.Send(true, receiver.GetAddress(), opener.GetAddress());
+
+    if (!WaitFor(gate.handled_, 4)) {
+        printf("    Sending from %s in %s framework: handled %d of 4 messages\n",
+            from_constructor ? "a constructor" : "a handler",
+            same_framework ? "the same" : "another",
+            gate.handled_.load());
+
+        // The worker thread is stuck, so the frameworks can't be shut down.
+        fflush(stdout);
+        _Exit(1);
+    }
+
+    return true;
+}
+
+
+int main(int argc, char *argv[]) {
+    const int count = (argc > 1 && atoi(argv[1]) > 0) ? atoi(argv[1]) : 20000;
+    const int senders = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 4;
+    const int rounds = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 20;
+
+    printf("Using count = %d (use first command line argument to change)\n", count);
+    printf("Using senders = %d (use second command line argument to change)\n", senders);
+    printf("Using rounds = %d (use third command line argument to change)\n", rounds);
+
+    printf("Sending to an actor with a credit window of one...\n");
+    const bool deferred(TestDeferring(count, senders, rounds));
+    printf(deferred ? "    All messages handled in order\n" : "    FAILED\n");
+
+    printf("Sending to a blocking actor from worker threads...\n");
+    const bool blocked(
+        TestBlocking(false, false) &&
+        TestBlocking(false, true) &&
+        TestBlocking(true, true));
+    printf(blocked ? "    No worker threads blocked\n" : "    FAILED\n");
+
+    return (deferred && blocked) ? 0 : 1;
+}
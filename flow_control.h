@@ -0,0 +1,36 @@
+#ifndef AF_FLOWCONTROL_H
+#define AF_FLOWCONTROL_H
+
+
+namespace AF
+{
+
+/*
+ * Enumerates the ways a send can wait for credit from a flow-controlled actor.
+ *
+ * An actor opts into flow control via Actor::SetCreditWindow. It then grants its senders a
+ * window of credits, one per message it can have queued, and each message it processes
+ * returns a credit. Sends to the actor made while it has no credit left are throttled:
+ *
+ * FLOW_CONTROL_DEFER - The message is held back, in order, and queued for the actor when it
+ *  next returns a credit. The send succeeds. Senders slow down by seeing their messages queue
+ *  up behind the window rather than inside the actor's mailbox.
+ *
+ * FLOW_CONTROL_BLOCK - The sending thread waits until a credit is returned. Worker threads
+ *  never block, since they may be needed to return the credit, so sends from message handlers,
+ *  or from anything they call such as actor constructors, are deferred instead. This holds for
+ *  the worker threads of every framework, not just the receiving actor's.
+ *
+ * FLOW_CONTROL_FAIL - The message is discarded and the send fails.
+ */
+enum FlowControlMode {
+    FLOW_CONTROL_DEFER = 0,             // Hold back the message until credit is returned.
+    FLOW_CONTROL_BLOCK,                 // Wait for credit, except on worker threads.
+    FLOW_CONTROL_FAIL                   // Fail the send.
+};
+
+
+} // namespace AF
+
+
+#endif // AF_FLOWCONTROL_H
@@ -12,7 +12,11 @@
 
 #include "AF/detail/scheduler/blocking_monitor.h"
 #include "AF/detail/scheduler/mailbox_queue.h"
+#include "AF/detail/scheduler/non_blocking_monitor.h"
 #include "AF/detail/scheduler/scheduler.h"
+#include "AF/detail/scheduler/thread_pool.h"
+#include "AF/detail/scheduler/work_stealing_queue.h"
+#include "AF/detail/scheduler/yielding_monitor.h"
 
 #include "AF/detail/strings/string.h"
 
@@ -23,6 +27,11 @@ namespace AF
 {
 
 void Framework::Initialize() {
+    AF_ASSERT_MSG(params_.throughput_ > 0, "Mailbox throughput must be at least one message");
+
+    // Create the heap used for messages sent from outside worker threads.
+    message_heap_ = Detail::MessageHeap::Create(true);
+
     scheduler_ = CreateScheduler();
 
     // Set up the scheduler.
@@ -50,27 +59,51 @@ void Framework::Release() {
     scheduler_->Release();
     DestroyScheduler(scheduler_);
     scheduler_ = 0;
+
+    message_heap_->Release();
+    message_heap_ = 0;
 }
 
 Detail::SchedulerInterface *Framework::CreateScheduler() {
-    typedef Detail::MailboxQueue<Detail::BlockingMonitor> BlockingQueue;
+    typedef Detail::BlockingMonitor BlockingMonitor;
+    typedef Detail::NonBlockingMonitor NonBlockingMonitor;
+    typedef Detail::YieldingMonitor YieldingMonitor;
+
+    // Instantiate the scheduler specialization matching the requested strategies.
+    if (params_.queue_strategy_ == QUEUE_STRATEGY_WORK_STEALING) {
+        switch (params_.yield_strategy_) {
+            case YIELD_STRATEGY_POLLING:    return CreateScheduler<Detail::WorkStealingQueue<NonBlockingMonitor> >();
+            case YIELD_STRATEGY_HYBRID:     return CreateScheduler<Detail::WorkStealingQueue<YieldingMonitor> >();
+            default:                        return CreateScheduler<Detail::WorkStealingQueue<BlockingMonitor> >();
+        }
+    }
+
+    switch (params_.yield_strategy_) {
+        case YIELD_STRATEGY_POLLING:        return CreateScheduler<Detail::MailboxQueue<NonBlockingMonitor> >();
+        case YIELD_STRATEGY_HYBRID:         return CreateScheduler<Detail::MailboxQueue<YieldingMonitor> >();
+        default:                            return CreateScheduler<Detail::MailboxQueue<BlockingMonitor> >();
+    }
+}
 
-    typedef Detail::Scheduler<BlockingQueue> BlockingScheduler;
+template <class QueueType>
+Detail::SchedulerInterface *Framework::CreateScheduler() {
+    typedef Detail::Scheduler<QueueType> SchedulerType;
 
     AllocatorInterface *const allocator(AllocatorManager::GetCache());
     void *scheduler_memory(0);
 
     scheduler_memory = allocator->AllocateAligned(
-        sizeof(BlockingScheduler),
+        sizeof(SchedulerType),
         AF_CACHELINE_ALIGNMENT);
 
     AF_ASSERT_MSG(scheduler_memory, "Failed to allocate scheduler");
 
-    return new (scheduler_memory) BlockingScheduler(
+    return new (scheduler_memory) SchedulerType(
         &mailboxes_,
         &fallback_handlers_,
-        &message_allocator_,
-        &shared_mailbox_context_);
+        message_heap_,
+        &shared_mailbox_context_,
+        params_.throughput_);
 }
 
 void Framework::DestroyScheduler(Detail::SchedulerInterface *const scheduler) {
@@ -83,38 +116,36 @@ void Framework::DestroyScheduler(Detail::SchedulerInterface *const scheduler) {
 void Framework::RegisterActor(Actor *const actor, const char *const name) {
     // Allocate an unused mailbox.
     const uint32_t mailbox_index(mailboxes_.Allocate());
+    const uint32_t generation(mailboxes_.GetGeneration(mailbox_index));
     Detail::Mailbox &mailbox(mailboxes_.GetEntry(mailbox_index));
 
     // Use the provided name for the actor if one was provided.
-    Detail::String mailbox_name(name);
-    if (name == 0) {
-        char raw_name[16];
-        Detail::NameGenerator::Generate(raw_name, mailbox_index);
-
-        char scoped_name[256];
-        Detail::NameGenerator::Combine(
-            scoped_name,
-            256,
-            raw_name,
-            name_.GetValue());
-
-        mailbox_name = Detail::String(scoped_name);
-    }
+    // Otherwise the mailbox is left unnamed, and its default name is generated only if asked for.
+    const Detail::String mailbox_name(name);
 
-    // Name the mailbox and register the actor.
+    // Name the mailbox and register the actor. Mailboxes are reused, so reset any capacity limit.
     mailbox.Lock();
+    mailbox.SetIndex(mailbox_index);
     mailbox.SetName(mailbox_name);
+    mailbox.SetCapacity(0, OVERFLOW_POLICY_REJECT);
+    mailbox.SetCreditWindow(0, FLOW_CONTROL_DEFER);
     mailbox.RegisterActor(actor);
     mailbox.Unlock();
 
     // Create the unique address of the mailbox.
-    // Its a pair comprising the framework index and the mailbox index within the framework.
-    const Detail::Index index(index_, mailbox_index);
-    const Address mailbox_address(mailbox_name, index);
+    // It comprises the framework index, the mailbox index within the framework, and the
+    // generation of the mailbox index, which distinguishes it from earlier users of the index.
+    const Detail::Index index(index_, mailbox_index, generation);
+    const Address mailbox_address(index);
 
     // Set the actor's mailbox address.
     // The address contains the index of the framework and the index of the mailbox within the framework.
     actor->address_ = mailbox_address;
+
+    // Make named actors addressable by name.
+    if (name) {
+        Detail::NameRegistry::Register(mailbox_name, index);
+    }
 }
 
 void Framework::DeregisterActor(Actor *const actor) {
@@ -124,8 +155,21 @@ void Framework::DeregisterActor(Actor *const actor) {
     const uint32_t mailbox_index(address.AsInteger());
     Detail::Mailbox &mailbox(mailboxes_.GetEntry(mailbox_index));
 
+    // Withdraw the actor's name first, so that it no longer resolves to the departing actor.
+    mailbox.Lock();
+    const Detail::String name(mailbox.GetName());
+    mailbox.Unlock();
+
+    if (!name.IsNull()) {
+        Detail::NameRegistry::Deregister(name, address.index_);
+    }
+
     // If the entry is pinned then we have to wait for it to be unpinned.
+    // Once the actor is deregistered other threads may free the mailbox,
+    // so everything else we need from it is done under the same lock.
     bool deregistered(false);
+    bool credit_waiters(false);
+    bool released(false);
     uint32_t backoff(0);
 
     while (!deregistered) {
@@ -134,33 +178,157 @@ void Framework::DeregisterActor(Actor *const actor) {
         if (!mailbox.IsPinned()) {
             mailbox.DeregisterActor();
             deregistered = true;
+
+            // Free the mailbox index for reuse. If messages are still queued then the
+            // worker thread that processes the last of them frees it instead.
+            credit_waiters = mailbox.HasCreditWaiters();
+            released = (mailbox.Empty() && mailbox.Release());
         }
 
         mailbox.Unlock();
 
         Detail::Utils::Backoff(backoff);
     }
+
+    // Wake any senders blocked waiting for credit from the departed actor.
+    // Blocked senders are inside the mailbox, so it can't have been freed under them.
+    if (credit_waiters) {
+        scheduler_->SignalCredit();
+    }
+
+    if (released) {
+        mailboxes_.Free(mailbox_index);
+    }
+}
+
+SendResult Framework::Overflow(
+    Detail::MailboxContext *const mailbox_context,
+    Detail::MessageInterface *const message,
+    const OverflowPolicy policy) {
+    SendResult result(SEND_RESULT_REJECTED);
+
+    switch (policy) {
+        case OVERFLOW_POLICY_DROP_NEWEST:
+            result = SEND_RESULT_DROPPED;
+            break;
+
+        case OVERFLOW_POLICY_FALLBACK:
+            fallback_handlers_.Handle(message);
+            result = SEND_RESULT_FALLBACK;
+            break;
+
+        default:
+            break;
+    }
+
+    Detail::MessageCreator::Destroy(mailbox_context->message_allocator_, message);
+    return result;
+}
+
+bool Framework::Throttle(
+    Detail::MailboxContext *const mailbox_context,
+    Detail::MessageInterface *const message,
+    Detail::Mailbox &mailbox,
+    SendResult &result) {
+    mailbox.CountThrottled();
+    scheduler_->IncrementCounter(mailbox_context, Detail::COUNTER_SENDS_THROTTLED);
+
+    switch (mailbox.GetFlowControlMode()) {
+        case FLOW_CONTROL_FAIL:
+            Detail::MessageCreator::Destroy(mailbox_context->message_allocator_, message);
+            result = SEND_RESULT_NO_CREDIT;
+            return false;
+
+        case FLOW_CONTROL_BLOCK:
+            // Only threads outside the worker threads block. Worker threads of any framework
+            // defer instead, whichever context they send from, since they may be needed to
+            // return the credit. Blocked threads wait until they claim a credit, or the actor
+            // goes away. The sender is inside the mailbox, so it can't be reused while we wait.
+            if (!Detail::WorkerThread::IsCurrent()) {
+                mailbox.AddCreditWaiter();
+
+                bool claimed(false);
+                while (!(claimed = mailbox.ClaimCredit())) {
+                    if (mailbox.IsRetired()) {
+                        break;
+                    }
+
+                    scheduler_->WaitForCredit(&mailbox);
+                }
+
+                mailbox.RemoveCreditWaiter();
+
+                if (claimed) {
+                    return true;
+                }
+
+                fallback_handlers_.Handle(message);
+                Detail::MessageCreator::Destroy(mailbox_context->message_allocator_, message);
+                result = SEND_RESULT_UNDELIVERED;
+                return false;
+            }
+
+            break;
+
+        default:
+            break;
+    }
+
+    if (mailbox.Defer(message)) {
+        // The consumer may have emptied the mailbox without seeing the deferred message,
+        // so admit any deferred messages there's credit for now, or it may never be admitted.
+        bool woken(false);
+        while (mailbox.Undefer(woken)) {
+        }
+
+        if (woken) {
+            mailbox_context->Schedule(&mailbox);
+        }
+
+        result = SEND_RESULT_DEFERRED;
+        return false;
+    }
+
+    return true;
 }
 
-bool Framework::DeliverWithinLocalProcess(Detail::MessageInterface *const message, const Detail::Index &index) {
+SendResult Framework::DeliverWithinLocalProcess(
+    AllocatorInterface *const message_allocator,
+    Detail::MessageInterface *const message,
+    const Detail::Index &index) {
     const uint32_t target_framework_index(index.componets_.framework_);
 
-    AF_ASSERT(index.uint32_ != 0);
+    // Null addresses, such as those of unregistered names, don't address any entity.
+    if (index.uint64_ == 0) {
+        return SEND_RESULT_UNDELIVERED;
+    }
 
     // Is the message addressed to a receiver? Receiver addresses have zero framework indices.
     if (target_framework_index == 0) {
-        // Get a reference to the receiver directory entry for this address.
-        Detail::Entry &entry(Detail::StaticDirectory<Receiver>::GetEntry(index.componets_.index_));
+        // Acquire the receiver directory entry for this address, which may have been reclaimed.
+        const uint32_t receiver_index(index.componets_.index_);
+        Detail::Entry *const acquired(Detail::StaticDirectory<Receiver>::Acquire(receiver_index));
+        if (acquired == 0) {
+            return SEND_RESULT_UNDELIVERED;
+        }
+
+        Detail::Entry &entry(*acquired);
 
         // Pin the entry and lookup the entity registered at the address.
         entry.Lock();
         entry.Pin();
-        Receiver *const receiver(static_cast<Receiver *>(entry.GetEntity()));
+        Receiver *receiver(static_cast<Receiver *>(entry.GetEntity()));
         entry.Unlock();
 
+        // A receiver registered at a reused index isn't the one the address was issued for.
+        // The index can't be freed while the entry is pinned, so the generation is stable here.
+        if (Detail::StaticDirectory<Receiver>::GetGeneration(receiver_index) != index.componets_.generation_) {
+            receiver = 0;
+        }
+
         // If a receiver is registered at the mailbox then deliver the message to it.
         if (receiver) {
-            receiver->Push(message);
+            receiver->Push(message_allocator, message);
         }
 
         // Unpin the entry, allowing it to be changed by other threads.
@@ -168,14 +336,21 @@ bool Framework::DeliverWithinLocalProcess(Detail::MessageInterface *const messag
         entry.Unpin();
         entry.Unlock();
 
-        return (receiver != 0);
+        Detail::StaticDirectory<Receiver>::Release(receiver_index);
+
+        return receiver ? SEND_RESULT_DELIVERED : SEND_RESULT_UNDELIVERED;
     }
 
-    bool delivered(false);
+    SendResult result(SEND_RESULT_UNDELIVERED);
 
-    // TODO: Return a pointer so we can handle missing pages gracefully.
-    // Get the entry for the addressed framework.
-    Detail::Entry &entry(Detail::StaticDirectory<Framework>::GetEntry(index.componets_.framework_));
+    // Acquire the entry for the addressed framework, which may have been reclaimed.
+    const uint32_t framework_index(index.componets_.framework_);
+    Detail::Entry *const acquired(Detail::StaticDirectory<Framework>::Acquire(framework_index));
+    if (acquired == 0) {
+        return SEND_RESULT_UNDELIVERED;
+    }
+
+    Detail::Entry &entry(*acquired);
 
     // Pin the entry and lookup the framework registered at the index.
     entry.Lock();
@@ -185,9 +360,8 @@ bool Framework::DeliverWithinLocalProcess(Detail::MessageInterface *const messag
 
     // If a framework is registered at this index then forward the message to it.
     if (framework) {
-        // The address is just an index with no name.
-        const Address address(Detail::String(), index);
-        delivered = framework->FrameworkReceive(message, address);
+        const Address address(index);
+        result = framework->FrameworkReceive(message, address);
     }
 
     // Unpin the entry, allowing it to be changed by other threads.
@@ -195,7 +369,9 @@ bool Framework::DeliverWithinLocalProcess(Detail::MessageInterface *const messag
     entry.Unpin();
     entry.Unlock();
 
-    return delivered;
+    Detail::StaticDirectory<Framework>::Release(framework_index);
+
+    return result;
 }
 
 
@@ -2,7 +2,10 @@
 #define AF_FRAMEWORK_H
 
 #include <new>
+#include <type_traits>
+#include <utility>
 
+#include "AF/actor_group.h"
 #include "AF/address.h"
 #include "AF/align.h"
 #include "AF/allocator_interface.h"
@@ -10,11 +13,18 @@
 #include "AF/assert.h"
 #include "AF/basic_types.h"
 #include "AF/defines.h"
+#include "AF/flow_control.h"
+#include "AF/message_priority.h"
+#include "AF/overflow_policy.h"
+#include "AF/queue_strategy.h"
+#include "AF/send_result.h"
+#include "AF/yield_strategy.h"
 
-#include "AF/detail/allocators/caching_allocator.h"
+#include "AF/detail/allocators/message_heap.h"
 
 #include "AF/detail/directory/directory.h"
 #include "AF/detail/directory/entry.h"
+#include "AF/detail/directory/name_registry.h"
 
 #include "AF/detail/handlers/default_fallback_handler.h"
 #include "AF/detail/handlers/fallback_handler_collection.h"
@@ -45,14 +55,24 @@ class Framework : public Detail::Entry::Entity {
 public:
 
     friend class Actor;
+    friend class Address;
 
     struct Parameters {
         inline explicit Parameters(
-            const uint32_t thread_count = 16) 
-          : thread_count_(thread_count) {
+            const uint32_t thread_count = 16,
+            const YieldStrategy yield_strategy = YIELD_STRATEGY_BLOCKING,
+            const QueueStrategy queue_strategy = QUEUE_STRATEGY_SHARED,
+            const uint32_t throughput = 16) 
+          : thread_count_(thread_count),
+            yield_strategy_(yield_strategy),
+            queue_strategy_(queue_strategy),
+            throughput_(throughput) {
         }
 
-        uint32_t thread_count_;   // The initial number of worker threads to create within the framework.
+        uint32_t thread_count_;             // The initial number of worker threads to create within the framework.
+        YieldStrategy yield_strategy_;      // How worker threads wait for work when idle.
+        QueueStrategy queue_strategy_;      // How scheduled mailboxes are shared between worker threads.
+        uint32_t throughput_;               // Maximum number of messages an actor processes each time it's scheduled.
     };
 
     inline explicit Framework(const uint32_t thread_count);
@@ -64,6 +84,48 @@ public:
     template <typename ValueType>
     inline bool Send(const ValueType &value, const Address &from, const Address &address);
 
+    /*
+     * Sends a copy of a value with the given priority, overriding the default priority of its type.
+     */
+    template <typename ValueType>
+    inline bool Send(const ValueType &value, const Address &from, const Address &address, const MessagePriority priority);
+
+    /*
+     * Sends a temporary value, moving it into the message instead of copying it.
+     */
+    template <typename ValueType, typename = typename std::enable_if<!std::is_lvalue_reference<ValueType>::value>::type>
+    inline bool Send(ValueType &&value, const Address &from, const Address &address);
+
+    /*
+     * Sends a message whose value is constructed in place from the given arguments.
+     */
+    template <typename ValueType, typename... ArgTypes>
+    inline bool Emplace(const Address &from, const Address &address, ArgTypes &&... args);
+
+    /*
+     * Sends a copy of a value, returning what became of the message.
+     */
+    template <typename ValueType>
+    inline SendResult TrySend(const ValueType &value, const Address &from, const Address &address);
+
+    /*
+     * Sends a copy of a value to each of an array of addresses.
+     * The value is copied once into a single memory block shared by all the messages, and the
+     * receiving mailboxes are scheduled together. Returns true if every message was delivered.
+     */
+    template <typename ValueType>
+    inline bool SendMulti(
+        const ValueType &value,
+        const Address &from,
+        const Address *const addresses,
+        const uint32_t count);
+
+    /*
+     * Sends a copy of a value to each member of an actor group.
+     */
+    template <typename ValueType>
+    inline bool SendMulti(const ValueType &value, const Address &from, const ActorGroup &group);
+
     inline void SetMaxThreads(const uint32_t count);
 
     inline void SetMinThreads(const uint32_t count);
@@ -99,25 +161,13 @@ public:
         ObjectType *const actor,
         void (ObjectType::*handler)(const void *const data, const uint32_t size, const Address from));
 
-    static bool DeliverWithinLocalProcess(
+    static SendResult DeliverWithinLocalProcess(
+        AllocatorInterface *const message_allocator,
         Detail::MessageInterface *const message,
         const Detail::Index &index);
 
 private:
 
-    struct MessageCacheTraits {
-        typedef Detail::SpinLock LockType;
-
-        struct AF_PREALIGN(AF_CACHELINE_ALIGNMENT) AlignType
-        {
-        } AF_POSTALIGN(AF_CACHELINE_ALIGNMENT);
-
-        static const uint32_t MAX_POOLS = 8;
-        static const uint32_t MAX_BLOCKS = 16;
-    };
-
-    typedef Detail::CachingAllocator<MessageCacheTraits> MessageCache;
-
     Framework(const Framework &other);
     Framework &operator=(const Framework &other);
 
@@ -127,45 +177,105 @@ private:
 
     Detail::SchedulerInterface *CreateScheduler();
 
+    template <class QueueType>
+    Detail::SchedulerInterface *CreateScheduler();
+
     void DestroyScheduler(Detail::SchedulerInterface *const scheduler);
 
     void RegisterActor(Actor *const actor, const char *const name = 0);
 
     void DeregisterActor(Actor *const actor);
 
-    inline bool SendInternal(
+    template <typename ValueType, typename... ArgTypes>
+    inline SendResult EmplaceInternal(
+        const Address &from,
+        const Address &address,
+        const MessagePriority priority,
+        ArgTypes &&... args);
+
+    /*
+     * Returns true if the result is that of a message accepted by the addressed mailbox.
+     */
+    inline static bool Accepted(const SendResult result);
+
+    /*
+     * Enters the mailbox addressed by the given index to send to it, if the address is current.
+     * Returns null if the address is stale. The mailbox can't be reused until it's left.
+     */
+    inline Detail::Mailbox *EnterMailbox(const Detail::Index &index);
+
+    /*
+     * Leaves a mailbox entered to send to it, freeing its index if it was vacated meanwhile.
+     */
+    inline void LeaveMailbox(const uint32_t mailbox_index, Detail::Mailbox *const mailbox);
+
+    inline SendResult SendInternal(
         Detail::MailboxContext *const mailbox_context,
         Detail::MessageInterface *const message,
         Address address);
 
-    inline bool FrameworkReceive(
+    /*
+     * Disposes of a message sent to a full mailbox, according to the mailbox's overflow policy.
+     */
+    SendResult Overflow(
+        Detail::MailboxContext *const mailbox_context,
+        Detail::MessageInterface *const message,
+        const OverflowPolicy policy);
+
+    /*
+     * Holds back a message sent to a flow-controlled mailbox with no credit, according to its mode.
+     * Returns true if the message can be pushed now, in which case a credit has been claimed for it,
+     * or otherwise sets the result of the send. Blocked sends fail if the actor is deregistered.
+     */
+    bool Throttle(
+        Detail::MailboxContext *const mailbox_context,
+        Detail::MessageInterface *const message,
+        Detail::Mailbox &mailbox,
+        SendResult &result);
+
+    /*
+     * Sends an array of messages sharing one value to the given addresses, one message per address.
+     * Newly non-empty local mailboxes are collected and scheduled in batches.
+     */
+    template <class MessageType>
+    inline bool SendMultiInternal(
+        Detail::MailboxContext *const mailbox_context,
+        MessageType *const messages,
+        const Address *const addresses,
+        const uint32_t count);
+
+    inline SendResult FrameworkReceive(
         Detail::MessageInterface *const message,
         const Address &address);
 
     inline Detail::MailboxContext *GetMailboxContext();
 
     Detail::StringPool::Ref string_pool_ref_;                 // Ensures that the StringPool is created.
+    Detail::NameRegistry::Ref name_registry_ref_;             // Ensures that the NameRegistry is created.
     const Parameters params_;                                 // Copy of parameters struct provided on construction.
     uint32_t index_;                                          // Non-zero index of this framework, unique within the local process.
     Detail::String name_;                                     // Name of this framework.
     Detail::Directory<Detail::Mailbox> mailboxes_;            // Per-framework mailbox array.
     Detail::FallbackHandlerCollection fallback_handlers_;     // Registered message handlers run for unhandled messages.
     Detail::DefaultFallbackHandler default_fallback_handler_; // Default handler for unhandled messages.
-    MessageCache message_allocator_;                          // Thread-safe per-framework cache of message memory blocks.
+    Detail::MessageHeap *message_heap_;                       // Thread-safe per-framework heap of message memory blocks.
     Detail::MailboxContext shared_mailbox_context_;           // Shared per-framework mailbox context.
     Detail::SchedulerInterface *scheduler_;                   // Pointer to owned scheduler implementation.
+
+    static const uint32_t MAX_SCHEDULE_BATCH = 64;            // Maximum number of mailboxes scheduled together by SendMulti.
 };
 
 
 inline Framework::Framework(const uint32_t thread_count) 
   : string_pool_ref_(),
+    name_registry_ref_(),
     params_(thread_count),
     index_(0),
     name_(),
     mailboxes_(),
     fallback_handlers_(),
     default_fallback_handler_(),
-    message_allocator_(AllocatorManager::GetCache()),
+    message_heap_(0),
     shared_mailbox_context_(),
     scheduler_(0) {
 
@@ -174,13 +284,14 @@ inline Framework::Framework(const uint32_t thread_count)
 
 inline Framework::Framework(const Parameters &params) 
   : string_pool_ref_(),
+    name_registry_ref_(),
     params_(params),
     index_(0),
     name_(),
     mailboxes_(),
     fallback_handlers_(),
     default_fallback_handler_(),
-    message_allocator_(AllocatorManager::GetCache()),
+    message_heap_(0),
     shared_mailbox_context_(),
     scheduler_(0) {
 
@@ -193,15 +304,59 @@ inline Framework::~Framework() {
 
 template <typename ValueType>
 AF_FORCEINLINE bool Framework::Send(const ValueType &value, const Address &from, const Address &address) {
-    // We use a thread-safe per-framework message cache to allocate messages sent from non-actor code.
-    AllocatorInterface *const message_allocator(&message_allocator_);
+    return Emplace<ValueType>(from, address, value);
+}
+
+template <typename ValueType>
+AF_FORCEINLINE bool Framework::Send(
+    const ValueType &value,
+    const Address &from,
+    const Address &address,
+    const MessagePriority priority) {
+    return Accepted(EmplaceInternal<ValueType>(from, address, priority, value));
+}
+
+template <typename ValueType, typename>
+AF_FORCEINLINE bool Framework::Send(ValueType &&value, const Address &from, const Address &address) {
+    // Const temporaries are sent as messages of the unqualified type, so they reach its handlers.
+    typedef typename std::remove_const<ValueType>::type MessageType;
+    return Emplace<MessageType>(from, address, std::move(value));
+}
+
+template <typename ValueType, typename... ArgTypes>
+AF_FORCEINLINE bool Framework::Emplace(const Address &from, const Address &address, ArgTypes &&... args) {
+    return Accepted(EmplaceInternal<ValueType>(
+        from,
+        address,
+        Detail::MessagePriorityTraits<ValueType>::PRIORITY,
+        std::forward<ArgTypes>(args)...));
+}
+
+template <typename ValueType>
+AF_FORCEINLINE SendResult Framework::TrySend(const ValueType &value, const Address &from, const Address &address) {
+    return EmplaceInternal<ValueType>(from, address, Detail::MessagePriorityTraits<ValueType>::PRIORITY, value);
+}
+
+template <typename ValueType, typename... ArgTypes>
+AF_FORCEINLINE SendResult Framework::EmplaceInternal(
+    const Address &from,
+    const Address &address,
+    const MessagePriority priority,
+    ArgTypes &&... args) {
+    // We use a thread-safe per-framework message heap to allocate messages sent from non-actor code.
+    AllocatorInterface *const message_allocator(message_heap_);
 
     // Allocate a message. It'll be deleted by the worker thread that handles it.
-    Detail::MessageInterface *const message(Detail::MessageCreator::Create(message_allocator, value, from));
+    Detail::MessageInterface *const message(Detail::MessageCreator::Create<ValueType>(
+        message_allocator,
+        from,
+        std::forward<ArgTypes>(args)...));
     if (message == 0) {
-        return false;
+        return SEND_RESULT_NO_MEMORY;
     }
 
+    message->SetPriority(priority);
+
     // Call the message sending implementation using the processor context of the framework.
     // When messages are sent using Framework::Send there's no obvious worker thread.
     return SendInternal(
@@ -210,6 +365,38 @@ AF_FORCEINLINE bool Framework::Send(const ValueType &value, const Address &from,
         address);
 }
 
+template <typename ValueType>
+inline bool Framework::SendMulti(
+    const ValueType &value,
+    const Address &from,
+    const Address *const addresses,
+    const uint32_t count) {
+    if (count == 0) {
+        return true;
+    }
+
+    // Allocate all the messages, and one copy of the value, in a single block.
+    Detail::Message<ValueType> *const messages(Detail::MessageCreator::CreateShared<ValueType>(
+        message_heap_,
+        count,
+        from,
+        value));
+    if (messages == 0) {
+        return false;
+    }
+
+    return SendMultiInternal(
+        &shared_mailbox_context_,
+        messages,
+        addresses,
+        count);
+}
+
+template <typename ValueType>
+AF_FORCEINLINE bool Framework::SendMulti(const ValueType &value, const Address &from, const ActorGroup &group) {
+    return SendMulti(value, from, group.GetAddresses(), group.Size());
+}
+
 AF_FORCEINLINE void Framework::SetMaxThreads(const uint32_t count) {
     scheduler_->SetMaxThreads(count);
 }
@@ -235,7 +422,7 @@ AF_FORCEINLINE uint32_t Framework::GetPeakThreads() const {
 }
 
 AF_FORCEINLINE uint32_t Framework::GetNumCounters() const {
-#if aF_ENABLE_COUNTERS
+#if AF_ENABLE_COUNTERS
     return Detail::MAX_COUNTERS;
 #else
     return 0;
@@ -248,13 +435,17 @@ AF_FORCEINLINE const char *Framework::GetCounterName(const uint32_t counter) con
         switch (counter) {
             case Detail::COUNTER_MESSAGES_PROCESSED:        return "messages processed";
             case Detail::COUNTER_YIELDS:                    return "thread yields";
+            case Detail::COUNTER_WAKEUPS_AVOIDED:           return "thread wake-ups avoided";
             case Detail::COUNTER_LOCAL_PUSHES:              return "mailboxes pushed to thread-local message queue";
             case Detail::COUNTER_SHARED_PUSHES:             return "mailboxes pushed to per-framework message queue";
+            case Detail::COUNTER_STEALS:                    return "mailboxes stolen from other threads' message queues";
             case Detail::COUNTER_MAILBOX_QUEUE_MAX:         return "maximum size of mailbox queue";
             case Detail::COUNTER_QUEUE_LATENCY_LOCAL_MIN:   return "minimum observed latency of thread-local queue";
             case Detail::COUNTER_QUEUE_LATENCY_LOCAL_MAX:   return "maximum observed latency of thread-local queue";
             case Detail::COUNTER_QUEUE_LATENCY_SHARED_MIN:  return "minimum observed latency of per-framework queue";
             case Detail::COUNTER_QUEUE_LATENCY_SHARED_MAX:  return "maximum observed latency of per-framework queue";
+            case Detail::COUNTER_SENDS_THROTTLED:           return "sends to flow-controlled actors without credit";
+            case Detail::COUNTER_HIGH_PRIORITY_PUSHES:      return "mailboxes pushed to high-priority queue";
             default: return "unknown";
         }
 #endif
@@ -292,51 +483,193 @@ AF_FORCEINLINE uint32_t Framework::GetPerThreadCounterValues(
     return 0;
 }
 
-AF_FORCEINLINE bool Framework::SendInternal(
+AF_FORCEINLINE bool Framework::Accepted(const SendResult result) {
+    return (result == SEND_RESULT_DELIVERED || result == SEND_RESULT_DEFERRED || result == SEND_RESULT_DROPPED);
+}
+
+AF_FORCEINLINE Detail::Mailbox *Framework::EnterMailbox(const Detail::Index &index) {
+    const uint32_t mailbox_index(index.componets_.index_);
+
+    // Mailboxes in reclaimed pages are long gone.
+    Detail::Mailbox *const mailbox(mailboxes_.Acquire(mailbox_index));
+    if (mailbox == 0) {
+        return 0;
+    }
+
+    // Entering the mailbox holds off its release, so if the generation still matches
+    // once we're inside, the index can't be freed and reused until we leave.
+    if (mailbox->Enter()) {
+        if (mailboxes_.GetGeneration(mailbox_index) == index.componets_.generation_) {
+            return mailbox;
+        }
+
+        LeaveMailbox(mailbox_index, mailbox);
+        return 0;
+    }
+
+    mailboxes_.Release(mailbox_index);
+    return 0;
+}
+
+AF_FORCEINLINE void Framework::LeaveMailbox(const uint32_t mailbox_index, Detail::Mailbox *const mailbox) {
+    // The last sender to leave a retired mailbox frees it if no messages are left to do so.
+    // Only retired mailboxes take the lock, which is needed to check the mailbox isn't pinned.
+    if (mailbox->Leave()) {
+        mailbox->Lock();
+        const bool released(mailbox->Empty() && mailbox->Release());
+        mailbox->Unlock();
+
+        if (released) {
+            mailboxes_.Free(mailbox_index);
+        }
+    }
+
+    mailboxes_.Release(mailbox_index);
+}
+
+AF_FORCEINLINE SendResult Framework::SendInternal(
     Detail::MailboxContext *const mailbox_context,
     Detail::MessageInterface *const message,
     Address address) {
-    // The address should have been resolved to a non-zero local index.
-    AF_ASSERT(address.index_.uint32_);
-
     // Is the addressed entity in the local framework?
     if (address.index_.componets_.framework_ == index_) {
         // Message is addressed to an actor in the sending framework.
-        // Get a reference to the destination mailbox.
-        Detail::Mailbox &mailbox(mailboxes_.GetEntry(address.index_.componets_.index_));
-
-        // Push the message into the mailbox and schedule the mailbox for processing
-        // if it was previously empty, so won't already be scheduled.
-        // The message will be destroyed by the worker thread that does the processing,
-        // even if it turns out that no actor is registered with the mailbox.
-        mailbox.Lock();
-
-        const bool schedule(mailbox.Empty());
-        mailbox.Push(message);
+        // Enter the destination mailbox. Addresses issued for an earlier use of a reused mailbox are stale.
+        Detail::Mailbox *const entered(EnterMailbox(address.index_));
+        if (entered == 0) {
+            fallback_handlers_.Handle(message);
+            Detail::MessageCreator::Destroy(mailbox_context->message_allocator_, message);
 
-        if (schedule) {
-            scheduler_->Schedule(mailbox_context, &mailbox);
+            return SEND_RESULT_UNDELIVERED;
         }
 
-        mailbox.Unlock();
+        Detail::Mailbox &mailbox(*entered);
+        SendResult result(SEND_RESULT_DELIVERED);
+
+        // A full mailbox disposes of the message according to its policy, unless it drops older messages instead.
+        if (mailbox.IsFull() && mailbox.GetOverflowPolicy() != OVERFLOW_POLICY_DROP_OLDEST) {
+            result = Overflow(mailbox_context, message, mailbox.GetOverflowPolicy());
+        } else {
+            // Flow-controlled mailboxes hold back messages sent without credit.
+            // Senders with credit claim it first, and settle the claim once they've pushed.
+            const bool flow_controlled(mailbox.GetCreditWindow() != 0);
+            if (!flow_controlled || mailbox.ClaimCredit() || Throttle(mailbox_context, message, mailbox, result)) {
+                // Push the message into the mailbox and schedule the mailbox for processing
+                // if it was previously empty, so won't already be scheduled.
+                // The message will be destroyed by the worker thread that does the processing,
+                // even if it turns out that no actor is registered with the mailbox.
+                // Mailboxes scheduled from within a message handler are batched until it returns.
+                if (mailbox.Push(message)) {
+                    mailbox_context->Schedule(&mailbox);
+                }
+
+                if (flow_controlled) {
+                    mailbox.SettleCredit();
+                }
+            }
+        }
 
-        return true;
+        LeaveMailbox(address.index_.componets_.index_, &mailbox);
+        return result;
     }
 
     // Message is addressed to a mailbox in the local process but not in the
     // sending Framework. In this less common case we pay the hit of an extra call.
-    if (DeliverWithinLocalProcess(message, address.index_)) {
-        return true;
+    const SendResult result(DeliverWithinLocalProcess(mailbox_context->message_allocator_, message, address.index_));
+    if (result != SEND_RESULT_UNDELIVERED) {
+        return result;
     }
 
     // Destroy the undelivered message.
     fallback_handlers_.Handle(message);
-    Detail::MessageCreator::Destroy(&message_allocator_, message);
+    Detail::MessageCreator::Destroy(mailbox_context->message_allocator_, message);
+
+    return SEND_RESULT_UNDELIVERED;
+}
+
+template <class MessageType>
+inline bool Framework::SendMultiInternal(
+    Detail::MailboxContext *const mailbox_context,
+    MessageType *const messages,
+    const Address *const addresses,
+    const uint32_t count) {
+    Detail::Mailbox *scheduled[MAX_SCHEDULE_BATCH];
+    uint32_t scheduled_count(0);
+    bool delivered(true);
+
+    for (uint32_t index = 0; index < count; ++index) {
+        MessageType *const message(messages + index);
+        const Address &address(addresses[index]);
+
+        if (address.index_.componets_.framework_ == index_) {
+            Detail::Mailbox *const entered(EnterMailbox(address.index_));
+            if (entered == 0) {
+                fallback_handlers_.Handle(message);
+                Detail::MessageCreator::Destroy(mailbox_context->message_allocator_, message);
+                delivered = false;
+                continue;
+            }
+
+            Detail::Mailbox &mailbox(*entered);
+            SendResult result(SEND_RESULT_DELIVERED);
+            bool schedule(false);
+
+            if (mailbox.IsFull() && mailbox.GetOverflowPolicy() != OVERFLOW_POLICY_DROP_OLDEST) {
+                result = Overflow(mailbox_context, message, mailbox.GetOverflowPolicy());
+            } else {
+                const bool flow_controlled(mailbox.GetCreditWindow() != 0);
+                if (!flow_controlled || mailbox.ClaimCredit() || Throttle(mailbox_context, message, mailbox, result)) {
+                    schedule = mailbox.Push(message);
+
+                    if (flow_controlled) {
+                        mailbox.SettleCredit();
+                    }
+                }
+            }
+
+            if (!Accepted(result)) {
+                delivered = false;
+            }
+
+            // Mailboxes that were empty are scheduled in batches, each pushed to the queue at once.
+            // Within a message handler the context batches them for us, along with any other sends.
+            // A scheduled mailbox has a message queued, so it can't be released when we leave it.
+            if (schedule) {
+                if (mailbox_context->IsDeferring()) {
+                    mailbox_context->Schedule(&mailbox);
+                } else {
+                    scheduled[scheduled_count++] = &mailbox;
+                    if (scheduled_count == MAX_SCHEDULE_BATCH) {
+                        scheduler_->ScheduleBatch(mailbox_context, scheduled, scheduled_count);
+                        scheduled_count = 0;
+                    }
+                }
+            }
+
+            LeaveMailbox(address.index_.componets_.index_, &mailbox);
+            continue;
+        }
+
+        const SendResult result(DeliverWithinLocalProcess(mailbox_context->message_allocator_, message, address.index_));
+        if (result == SEND_RESULT_UNDELIVERED) {
+            // Destroy the undelivered message. The shared value lives on in the other messages.
+            fallback_handlers_.Handle(message);
+            Detail::MessageCreator::Destroy(mailbox_context->message_allocator_, message);
+        }
+
+        if (!Accepted(result)) {
+            delivered = false;
+        }
+    }
+
+    if (scheduled_count) {
+        scheduler_->ScheduleBatch(mailbox_context, scheduled, scheduled_count);
+    }
 
-    return false;
+    return delivered;
 }
 
-AF_FORCEINLINE bool Framework::FrameworkReceive(
+AF_FORCEINLINE SendResult Framework::FrameworkReceive(
     Detail::MessageInterface *const message,
     const Address &address) {
     // Call the generic message sending function.
@@ -0,0 +1,73 @@
+#ifndef AF_MESSAGEPRIORITY_H
+#define AF_MESSAGEPRIORITY_H
+
+
+namespace AF
+{
+
+/*
+ * Enumerates the priorities with which messages can be sent.
+ *
+ * Each message carries a priority, which is the default priority of its value type unless
+ * one is given when the message is sent. The default priority of a type is normal, and can
+ * be raised with AF_PRIORITIZE_MESSAGE.
+ *
+ * MESSAGE_PRIORITY_NORMAL - The message is processed in the order in which it was sent.
+ *
+ * MESSAGE_PRIORITY_HIGH - The message overtakes any normal messages queued in the receiving
+ *  actor's mailbox. High-priority messages are processed in the order in which they were
+ *  sent, with respect to each other. A mailbox holding high-priority messages is also
+ *  scheduled ahead of mailboxes holding only normal messages.
+ */
+enum MessagePriority {
+    MESSAGE_PRIORITY_NORMAL = 0,        // Process the message in order.
+    MESSAGE_PRIORITY_HIGH               // Process the message ahead of normal messages.
+};
+
+
+namespace Detail
+{
+
+/*
+ * Traits struct template that stores the default priority of messages.
+ *
+ * This is kept apart from MessageTraits, which is specialized by the registration macros,
+ * so that a type can be both registered and prioritized.
+ */
+template <class MessageType>
+struct MessagePriorityTraits {
+    // The default priority is normal.
+    static const MessagePriority PRIORITY = MESSAGE_PRIORITY_NORMAL;
+};
+
+} // namespace Detail
+} // namespace AF
+
+
+/*
+ * AF_PRIORITIZE_MESSAGE
+ * Sets the default priority with which messages of a type are sent.
+ *
+ * namespace MyNamespace
+ * {
+ * class MyMessage {
+ * };
+ * }
+ * AF_PRIORITIZE_MESSAGE(MyNamespace::MyMessage, AF::MESSAGE_PRIORITY_HIGH);
+ */
+#ifndef AF_PRIORITIZE_MESSAGE
+#define AF_PRIORITIZE_MESSAGE(MessageType, priority)                        \
+namespace AF                                                                \
+{                                                                           \
+namespace Detail                                                            \
+{                                                                           \
+template <>                                                                 \
+struct MessagePriorityTraits<MessageType> {                                 \
+    static const MessagePriority PRIORITY = (priority);                     \
+};                                                                          \
+}                                                                           \
+}
+#endif // AF_PRIORITIZE_MESSAGE
+
+
+#endif // AF_MESSAGEPRIORITY_H
@@ -0,0 +1,37 @@
+#ifndef AF_OVERFLOWPOLICY_H
+#define AF_OVERFLOWPOLICY_H
+
+
+namespace AF
+{
+
+/*
+ * Enumerates the ways a bounded mailbox can treat messages sent to it once it's full.
+ *
+ * Mailboxes are unbounded by default. A capacity is set per actor via Actor::SetMailboxCapacity,
+ * together with one of these policies, so a slow actor can't accumulate messages without limit.
+ *
+ * OVERFLOW_POLICY_REJECT - New messages are discarded and the send fails.
+ *
+ * OVERFLOW_POLICY_DROP_OLDEST - New messages are always accepted, and the oldest queued messages
+ *  are discarded unhandled instead, so the actor sees only the most recent messages. Messages
+ *  are discarded by the thread processing the mailbox, so the mailbox can briefly hold more
+ *  than its capacity while a handler is executing.
+ *
+ * OVERFLOW_POLICY_DROP_NEWEST - New messages are discarded silently, and the send succeeds.
+ *
+ * OVERFLOW_POLICY_FALLBACK - New messages are passed to the framework's fallback handlers,
+ *  as if they were undelivered, and the send fails.
+ */
+enum OverflowPolicy {
+    OVERFLOW_POLICY_REJECT = 0,         // Fail the send.
+    OVERFLOW_POLICY_DROP_OLDEST,        // Discard the oldest queued message.
+    OVERFLOW_POLICY_DROP_NEWEST,        // Silently discard the new message.
+    OVERFLOW_POLICY_FALLBACK            // Pass the new message to the fallback handlers.
+};
+
+
+} // namespace AF
+
+
+#endif // AF_OVERFLOWPOLICY_H
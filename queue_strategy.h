@@ -0,0 +1,30 @@
+#ifndef AF_QUEUESTRATEGY_H
+#define AF_QUEUESTRATEGY_H
+
+
+namespace AF
+{
+
+/*
+ * Enumerates the available work queue strategies.
+ *
+ * The queue strategy of a framework controls how mailboxes scheduled for processing
+ * are distributed between its worker threads. It's set per framework via Framework::Parameters.
+ *
+ * QUEUE_STRATEGY_SHARED - Scheduled mailboxes are pushed to a single queue shared by
+ *  all worker threads and protected by a lock.
+ *
+ * QUEUE_STRATEGY_WORK_STEALING - Each worker thread pushes the mailboxes it schedules to
+ *  its own lock-free queue, and idle threads steal from the queues of other threads.
+ *  Reduces lock contention with many worker threads.
+ */
+enum QueueStrategy {
+    QUEUE_STRATEGY_SHARED = 0,          // All threads share a single locked queue.
+    QUEUE_STRATEGY_WORK_STEALING        // Each thread owns a queue that other threads can steal from.
+};
+
+
+} // namespace AF
+
+
+#endif // AF_QUEUESTRATEGY_H
@@ -29,25 +29,12 @@ Receiver::~Receiver() {
 void Receiver::Initialize() {
     // Register this receiver, claiming a unique address for this receiver.
     const uint32_t receiver_index(Detail::StaticDirectory<Receiver>::Register(this));
-
-    if (name_.IsNull()) {
-        char raw_name[16];
-        Detail::NameGenerator::Generate(raw_name, receiver_index);
-
-        char scoped_name[256];
-        Detail::NameGenerator::Combine(
-            scoped_name,
-            256,
-            raw_name,
-            0);
-
-        name_ = Detail::String(scoped_name);
-    }
+    const uint32_t generation(Detail::StaticDirectory<Receiver>::GetGeneration(receiver_index));
 
     // Receivers are identified as a receiver by a framework index of zero.
     // All frameworks have non-zero indices, so all actors have non-zero framework indices.
-    const Detail::Index index(0, receiver_index);
-    address_ = Address(name_, index);
+    const Detail::Index index(0, receiver_index, generation);
+    address_ = Address(index);
 
     // Register the receiver at its claimed address.
     Detail::Entry &entry(Detail::StaticDirectory<Receiver>::GetEntry(address_.AsInteger()));
@@ -44,6 +44,7 @@ class Receiver : public Detail::Entry::Entity {
 public:
 
     friend class Framework;
+    friend class Address;
 
     Receiver();
 
@@ -79,10 +80,10 @@ private:
 
     void Release();
 
-    inline void Push(Detail::MessageInterface *const message);
+    inline void Push(AllocatorInterface *const message_allocator, Detail::MessageInterface *const message);
 
     Detail::StringPool::Ref string_pool_ref_;           // Ensures that the StringPool is created.
-    Detail::String name_;                               // Name of the receiver.
+    Detail::String name_;                               // Name of the receiver, generated when first asked for.
     Address address_;                                   // Unique address of this receiver.
     MessageHandlerList message_handlers_;               // List of registered message handlers.
     mutable Detail::Condition condition_;               // Signals waiting threads when messages arrive.
@@ -100,10 +101,6 @@ inline bool Receiver::RegisterHandler(
     ClassType *const owner,
     void (ClassType::*handler)(const ValueType &message, const Address from)) {
 
-    // If the message value type has a valid (non-zero) type name defined for it,
-    // then we use explicit type names to match messages to handlers.
-    // The default value of zero will indicates that no type name has been defined,
-    // in which case we rely on automatically stored RTTI to identify message types.
     typedef Detail::ReceiverHandler<ClassType, ValueType> MessageHandlerType;
 
     // Allocate memory for a message handler object.
@@ -129,12 +126,10 @@ template <class ClassType, class ValueType>
 inline bool Receiver::DeregisterHandler(
     ClassType *const /*owner*/,
     void (ClassType::*handler)(const ValueType &message, const Address from)) {
-    // If the message value type has a valid (non-zero) type name defined for it,
-    // then we use explicit type IDs to match messages to handlers.
-    // The default value of zero will indicate that no type name has been defined,
-    // in which case we rely on automatically stored RTTI to identify message types.
+    // Handlers are matched by comparing their type identifiers, which needs neither RTTI
+    // nor registration of the message type.
     typedef Detail::ReceiverHandler<ClassType, ValueType> MessageHandlerType;
-    typedef Detail::ReceiverHandlerCast<ClassType, Detail::MessageTraits<ValueType>::HAS_TYPE_NAME> HandlerCaster;
+    typedef Detail::ReceiverHandlerCast<ClassType> HandlerCaster;
 
     condition_.GetMutex().Lock();
 
@@ -211,7 +206,7 @@ AF_FORCEINLINE uint32_t Receiver::Consume(const uint32_t max) {
     return num_consumed;
 }
 
-AF_FORCEINLINE void Receiver::Push(Detail::MessageInterface *const message) {
+AF_FORCEINLINE void Receiver::Push(AllocatorInterface *const message_allocator, Detail::MessageInterface *const message) {
     AF_ASSERT(message);
 
     condition_.GetMutex().Lock();
@@ -231,8 +226,7 @@ AF_FORCEINLINE void Receiver::Push(Detail::MessageInterface *const message) {
     condition_.PulseAll();
 
     // Destroy the message.
-    // We use the global allocator to allocate messages sent to receivers.
-    AllocatorInterface *const message_allocator(AllocatorManager::GetCache());
+    // We free it through the sender's allocator, which returns it to the heap that allocated it.
     Detail::MessageCreator::Destroy(message_allocator, message);
 }
 
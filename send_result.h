@@ -0,0 +1,29 @@
+#ifndef AF_SENDRESULT_H
+#define AF_SENDRESULT_H
+
+
+namespace AF
+{
+
+/*
+ * Enumerates the possible outcomes of a message send, as reported by TrySend.
+ *
+ * Send returns true for SEND_RESULT_DELIVERED, SEND_RESULT_DEFERRED and SEND_RESULT_DROPPED,
+ * whose messages were accepted by the addressed mailbox, and false otherwise.
+ */
+enum SendResult {
+    SEND_RESULT_DELIVERED = 0,          // The message was queued in the addressed mailbox.
+    SEND_RESULT_UNDELIVERED,            // Nothing was registered at the address, so the message was passed to the fallback handlers.
+    SEND_RESULT_NO_MEMORY,              // The message couldn't be allocated.
+    SEND_RESULT_REJECTED,               // The addressed mailbox was full and rejected the message.
+    SEND_RESULT_DROPPED,                // The addressed mailbox was full and silently discarded the message.
+    SEND_RESULT_FALLBACK,               // The addressed mailbox was full and passed the message to the fallback handlers.
+    SEND_RESULT_DEFERRED,               // The addressed actor had no credit left, so the message was held back until it has.
+    SEND_RESULT_NO_CREDIT               // The addressed actor had no credit left and rejected the message.
+};
+
+
+} // namespace AF
+
+
+#endif // AF_SENDRESULT_H
@@ -0,0 +1,220 @@
+#ifndef AF_SHAREDPAYLOAD_H
+#define AF_SHAREDPAYLOAD_H
+
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "AF/align.h"
+#include "AF/allocator_interface.h"
+#include "AF/allocator_manager.h"
+#include "AF/assert.h"
+#include "AF/basic_types.h"
+#include "AF/defines.h"
+
+
+namespace AF
+{
+
+/*
+ * A reference-counted handle to an immutable value, for sending the same large value to many actors.
+ *
+ * The value is constructed once, in a block allocated together with its reference count.
+ * Sending a SharedPayload sends only the handle: each message holds one reference, which it
+ * gives up when it's destroyed after its handlers have run, and the value is destroyed and its
+ * block freed when the last reference goes. Handlers register for SharedPayload<ValueType>
+ * messages in the usual way, and read the value through the handle.
+ *
+ * The reference count is updated atomically, so handles can be held by many threads at once,
+ * but the value itself is shared and mustn't be modified.
+ */
+template <class ValueType>
+class SharedPayload {
+public:
+    /*
+     * Constructs a null handle, which doesn't reference any value.
+     */
+    inline SharedPayload();
+
+    /*
+     * Creates a shared value constructed from the given arguments.
+     * Returns a null handle if the value couldn't be allocated.
+     */
+    template <class... ArgTypes>
+    inline static SharedPayload Create(ArgTypes &&... args);
+
+    inline SharedPayload(const SharedPayload &other);
+
+    inline SharedPayload(SharedPayload &&other);
+
+    inline ~SharedPayload();
+
+    inline SharedPayload &operator=(const SharedPayload &other);
+
+    inline SharedPayload &operator=(SharedPayload &&other);
+
+    inline bool IsNull() const;
+
+    /*
+     * Gets the shared value. The handle mustn't be null.
+     */
+    inline const ValueType &Value() const;
+
+    inline const ValueType &operator*() const;
+
+    inline const ValueType *operator->() const;
+
+    /*
+     * Gets the number of handles currently referencing the value, or zero for a null handle.
+     */
+    inline uint32_t GetReferenceCount() const;
+
+private:
+    /*
+     * Memory block holding the reference count and the shared value.
+     */
+    struct Block {
+        template <class... ArgTypes>
+        inline explicit Block(ArgTypes &&... args)
+          : references_(1),
+            value_(std::forward<ArgTypes>(args)...) {
+        }
+
+        std::atomic<uint32_t> references_;      // Number of handles referencing the block.
+        const ValueType value_;                 // The shared value.
+    };
+
+    inline explicit SharedPayload(Block *const block);
+
+    inline static uint32_t GetAlignment();
+
+    inline void Release();
+
+    Block *block_;                              // Referenced block, or null.
+};
+
+
+template <class ValueType>
+AF_FORCEINLINE SharedPayload<ValueType>::SharedPayload() : block_(0) {
+}
+
+template <class ValueType>
+AF_FORCEINLINE SharedPayload<ValueType>::SharedPayload(Block *const block) : block_(block) {
+}
+
+template <class ValueType>
+template <class... ArgTypes>
+inline SharedPayload<ValueType> SharedPayload<ValueType>::Create(ArgTypes &&... args) {
+    // The block may be freed by any thread, so we allocate it from the thread-safe global cache.
+    AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+    void *const memory(allocator->AllocateAligned(sizeof(Block), GetAlignment()));
+    if (memory == 0) {
+        return SharedPayload();
+    }
+
+    return SharedPayload(new (memory) Block(std::forward<ArgTypes>(args)...));
+}
+
+template <class ValueType>
+AF_FORCEINLINE SharedPayload<ValueType>::SharedPayload(const SharedPayload &other) : block_(other.block_) {
+    if (block_) {
+        block_->references_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template <class ValueType>
+AF_FORCEINLINE SharedPayload<ValueType>::SharedPayload(SharedPayload &&other) : block_(other.block_) {
+    other.block_ = 0;
+}
+
+template <class ValueType>
+AF_FORCEINLINE SharedPayload<ValueType>::~SharedPayload() {
+    Release();
+}
+
+template <class ValueType>
+AF_FORCEINLINE SharedPayload<ValueType> &SharedPayload<ValueType>::operator=(const SharedPayload &other) {
+    // Take the new reference before giving up the old one, in case they're the same.
+    if (other.block_) {
+        other.block_->references_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Release();
+    block_ = other.block_;
+
+    return *this;
+}
+
+template <class ValueType>
+AF_FORCEINLINE SharedPayload<ValueType> &SharedPayload<ValueType>::operator=(SharedPayload &&other) {
+    if (this != &other) {
+        Release();
+        block_ = other.block_;
+        other.block_ = 0;
+    }
+
+    return *this;
+}
+
+template <class ValueType>
+AF_FORCEINLINE bool SharedPayload<ValueType>::IsNull() const {
+    return (block_ == 0);
+}
+
+template <class ValueType>
+AF_FORCEINLINE const ValueType &SharedPayload<ValueType>::Value() const {
+    AF_ASSERT(block_);
+    return block_->value_;
+}
+
+template <class ValueType>
+AF_FORCEINLINE const ValueType &SharedPayload<ValueType>::operator*() const {
+    return Value();
+}
+
+template <class ValueType>
+AF_FORCEINLINE const ValueType *SharedPayload<ValueType>::operator->() const {
+    return &Value();
+}
+
+template <class ValueType>
+AF_FORCEINLINE uint32_t SharedPayload<ValueType>::GetReferenceCount() const {
+    if (block_) {
+        return block_->references_.load(std::memory_order_relaxed);
+    }
+
+    return 0;
+}
+
+template <class ValueType>
+AF_FORCEINLINE uint32_t SharedPayload<ValueType>::GetAlignment() {
+    // Allocators expect alignments of at least the size of a pointer.
+    uint32_t alignment(static_cast<uint32_t>(AF_ALIGNOF(Block)));
+    if (alignment < sizeof(void *)) {
+        alignment = sizeof(void *);
+    }
+
+    return alignment;
+}
+
+template <class ValueType>
+AF_FORCEINLINE void SharedPayload<ValueType>::Release() {
+    // Whoever gives up the last reference destroys the value and frees the block.
+    // The release-acquire ordering makes all uses of the value happen before its destruction.
+    if (block_ && block_->references_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        AllocatorInterface *const allocator(AllocatorManager::GetCache());
+
+        block_->~Block();
+        allocator->FreeWithSize(block_, sizeof(Block));
+    }
+
+    block_ = 0;
+}
+
+
+} // namespace AF
+
+
+#endif // AF_SHAREDPAYLOAD_H
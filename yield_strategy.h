@@ -0,0 +1,35 @@
+#ifndef AF_YIELDSTRATEGY_H
+#define AF_YIELDSTRATEGY_H
+
+
+namespace AF
+{
+
+/*
+ * Enumerates the available worker thread yield strategies.
+ *
+ * The yield strategy of a framework controls how its worker threads wait when
+ * they run out of work. It's set per framework via Framework::Parameters.
+ *
+ * YIELD_STRATEGY_BLOCKING - Idle threads block on a condition variable until woken.
+ *  Idle threads use no CPU time, but waking them adds latency to message sends.
+ *
+ * YIELD_STRATEGY_POLLING - Idle threads never block, repeatedly yielding the processor
+ *  and re-checking for work. Sends never pay for wake-ups, at the cost of keeping
+ *  idle threads runnable.
+ *
+ * YIELD_STRATEGY_HYBRID - Idle threads spin briefly, then yield, then block. The spin
+ *  time adapts to how soon work tends to arrive, so bursts of sends are picked up
+ *  without wake-up latency while long idle periods cost no CPU time.
+ */
+enum YieldStrategy {
+    YIELD_STRATEGY_BLOCKING = 0,        // Threads block on a condition variable when idle.
+    YIELD_STRATEGY_POLLING,             // Threads yield and poll for work when idle.
+    YIELD_STRATEGY_HYBRID               // Threads spin, then yield, then block when idle.
+};
+
+
+} // namespace AF
+
+
+#endif // AF_YIELDSTRATEGY_H